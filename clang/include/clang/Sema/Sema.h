@@ -13439,6 +13439,81 @@ public:
   std::vector<std::unique_ptr<TemplateInstantiationCallback>>
       TemplateInstCallbacks;
 
+  /// Statistics about the instantiations of one template specialization.
+  struct TemplateInstantiationStat {
+    /// The number of times the definition was instantiated.
+    unsigned NumInstantiations = 0;
+    /// The number of times the specialization or its definition was looked
+    /// up again after it had been created.
+    unsigned NumReLookups = 0;
+    /// The deepest instantiation depth the definition was instantiated at.
+    unsigned MaxDepth = 0;
+    /// The time spent instantiating the definition, including the
+    /// instantiations it triggered, in nanoseconds.
+    uint64_t TimeNs = 0;
+  };
+
+  /// Per-specialization instantiation statistics, collected with
+  /// -print-stats and -ftime-trace-verbose.
+  llvm::MapVector<const NamedDecl *, TemplateInstantiationStat>
+      TemplateInstantiationStats;
+
+  /// Whether \c TemplateInstantiationStats are collected.
+  bool shouldCollectTemplateInstantiationStats() const;
+
+  /// Records the instantiation of the definition of a specialization in
+  /// \c TemplateInstantiationStats while it is in scope.
+  class TemplateInstantiationStatScope {
+  public:
+    TemplateInstantiationStatScope(Sema &S, const NamedDecl *Spec);
+    ~TemplateInstantiationStatScope();
+
+    TemplateInstantiationStatScope(const TemplateInstantiationStatScope &) =
+        delete;
+    TemplateInstantiationStatScope &
+    operator=(const TemplateInstantiationStatScope &) = delete;
+
+  private:
+    Sema &S;
+    /// Null if the statistics are not collected.
+    const NamedDecl *Spec;
+    uint64_t StartNs = 0;
+  };
+
+  /// Notes that an existing specialization, or an existing definition of
+  /// it, was found again instead of being instantiated.
+  void noteTemplateSpecializationReLookup(const NamedDecl *Spec) {
+    if (shouldCollectTemplateInstantiationStats())
+      ++TemplateInstantiationStats[Spec].NumReLookups;
+  }
+
+  /// Prints the most expensive specializations in
+  /// \c TemplateInstantiationStats and the use of \c SubstTypeCache.
+  void PrintTemplateInstantiationStats() const;
+
+  /// Emits \c TemplateInstantiationStats as -ftime-trace events.
+  void emitTemplateInstantiationStatsTimeTrace() const;
+
+  /// The result of substituting template arguments into a type whose
+  /// substitution does not depend on the context, see \c SubstType.
+  class SubstTypeCacheEntry : public llvm::FastFoldingSetNode {
+  public:
+    SubstTypeCacheEntry(const llvm::FoldingSetNodeID &ID, QualType Result)
+        : FastFoldingSetNode(ID), Result(Result) {}
+
+    QualType Result;
+  };
+
+  /// A cache of successful substitutions of identical template arguments
+  /// into the same type, used with -fcache-template-type-substitutions.
+  llvm::FoldingSet<SubstTypeCacheEntry> SubstTypeCache;
+  unsigned NumSubstTypeCacheHits = 0;
+
+  /// The number of diagnostics requested through \c SemaBase::Diag, whether
+  /// they were emitted, deferred or suppressed in a SFINAE context. Used to
+  /// tell whether a substitution produced any diagnostic at all.
+  unsigned NumDiagsRequested = 0;
+
   /// The current index into pack expansion arguments that will be
   /// used for substitution of parameter packs.
   ///
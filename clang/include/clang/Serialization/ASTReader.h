@@ -1193,6 +1193,10 @@ private:
   unsigned NumTULocalVisibleDeclContexts = 0,
            TotalTULocalVisibleDeclContexts = 0;
 
+  /// Number of visible decl context lookups that the global module index
+  /// showed could not find anything.
+  unsigned NumVisibleDeclContextLookupsSkipped = 0;
+
   /// Total size of modules, in bits, currently loaded
   uint64_t TotalModulesSizeInBits = 0;
 
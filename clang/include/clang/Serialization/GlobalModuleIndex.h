@@ -111,6 +111,13 @@ class GlobalModuleIndex {
   /// identifier.
   unsigned NumIdentifierLookupHits;
 
+  /// The number of declaration name lookups we performed.
+  unsigned NumDeclNameLookups = 0;
+
+  /// The number of declaration name lookups for identifiers that none of the
+  /// module files have.
+  unsigned NumDeclNameLookupMisses = 0;
+
   /// Internal constructor. Use \c readIndex() to read an index.
   explicit GlobalModuleIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
                              llvm::BitstreamCursor Cursor);
@@ -155,6 +162,15 @@ public:
   /// \returns true if the identifier is known to the index, false otherwise.
   bool lookupIdentifier(llvm::StringRef Name, HitSet &Hits);
 
+  /// Determine whether any of the module files in the index has the given
+  /// identifier in its identifier table, interesting or not.
+  ///
+  /// A module file can only name a declaration with an identifier that it or
+  /// one of its imports has in its identifier table. If this returns false,
+  /// no name lookup table in the module files covered by the index has an
+  /// entry for the identifier.
+  bool hasIdentifier(llvm::StringRef Name);
+
   /// Note that the given module file has been loaded.
   ///
   /// \returns false if the global module index has information about this
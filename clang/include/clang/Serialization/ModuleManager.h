@@ -187,6 +187,12 @@ public:
   /// Number of modules loaded
   unsigned size() const { return Chain.size(); }
 
+  /// Determine whether a global module index is attached and has up-to-date
+  /// information about every module file that has been accepted.
+  bool isFullyCoveredByGlobalIndex() const {
+    return GlobalIndex && ModulesInCommonWithGlobalIndex.size() == size();
+  }
+
   /// The result of attempting to add a new module.
   enum AddModuleResult {
     /// The module file had already been loaded.
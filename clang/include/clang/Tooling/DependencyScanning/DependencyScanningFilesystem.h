@@ -14,6 +14,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include <mutex>
@@ -250,9 +251,53 @@ public:
   std::vector<OutOfDateEntry>
   getOutOfDateEntries(llvm::vfs::FileSystem &UnderlyingFS) const;
 
+  /// Loads the dependency directives saved by \c saveDependencyDirectives()
+  /// in a previous process from the file at \p Path, so that files that did
+  /// not change since then do not need to be scanned again. The saved
+  /// directives of a file are only used if its unique ID, size and
+  /// modification time are unchanged, which is checked when the file is first
+  /// scanned. A missing or invalid file, or one written by another version of
+  /// clang, is ignored.
+  ///
+  /// This must be called before the cache is used by any worker.
+  void loadDependencyDirectives(StringRef Path);
+
+  /// Saves the dependency directives of the files that were scanned, and of
+  /// the files loaded by \c loadDependencyDirectives() that were not seen
+  /// again, to the file at \p Path. Loaded files that were not seen by several
+  /// consecutive processes are dropped.
+  llvm::Error saveDependencyDirectives(StringRef Path) const;
+
+  /// Looks up the dependency directives saved for the file with status
+  /// \p Stat. On success, fills in \p Tokens and \p Directives, which refer
+  /// to \p Tokens, and returns true.
+  bool getSavedDependencyDirectives(
+      const llvm::vfs::Status &Stat,
+      SmallVectorImpl<dependency_directives_scan::Token> &Tokens,
+      SmallVectorImpl<dependency_directives_scan::Directive> &Directives) const;
+
 private:
   std::unique_ptr<CacheShard[]> CacheShards;
   unsigned NumShards;
+
+  /// A file whose dependency directives were loaded from disk.
+  struct SavedDirectivesEntry {
+    llvm::sys::TimePoint<> ModificationTime;
+    uint64_t Size;
+    /// Offset of the serialized tokens and directives in the buffer.
+    uint64_t TokensOffset;
+    uint32_t NumTokens;
+    uint64_t DirectivesOffset;
+    uint32_t NumDirectives;
+    /// The number of saves since the file was last seen.
+    uint32_t UnusedSaves;
+  };
+
+  /// The contents of the file loaded by \c loadDependencyDirectives(), which
+  /// are only read when a file is scanned.
+  std::unique_ptr<llvm::MemoryBuffer> SavedDirectivesBuffer;
+  llvm::DenseMap<llvm::sys::fs::UniqueID, SavedDirectivesEntry>
+      SavedDirectives;
 };
 
 /// This class is a local cache, that caches the 'stat' and 'open' calls to the
@@ -3398,15 +3398,11 @@ void CodeGenModule::EmitModuleLinkOptions() {
   }
 }
 
-void CodeGenModule::EmitDeferred() {
+bool CodeGenModule::takeDeferredDeclsToEmit(std::vector<GlobalDecl> &Decls) {
   // Emit deferred declare target declarations.
   if (getLangOpts().OpenMP && !getLangOpts().OpenMPSimd)
     getOpenMPRuntime().emitDeferredTargetDecls();
 
-  // Emit code for any potentially referenced deferred decls.  Since a
-  // previously unused static decl may become used during the generation of code
-  // for a static function, iterate until no changes are made.
-
   if (!DeferredVTables.empty()) {
     EmitDeferredVTables();
 
@@ -3425,14 +3421,50 @@ void CodeGenModule::EmitDeferred() {
 
   // Stop if we're out of both deferred vtables and deferred declarations.
   if (DeferredDeclsToEmit.empty())
-    return;
+    return false;
 
   // Grab the list of decls to emit. If EmitGlobalDefinition schedules more
-  // work, it will not interfere with this.
-  std::vector<GlobalDecl> CurDeclsToEmit;
-  CurDeclsToEmit.swap(DeferredDeclsToEmit);
+  // work, it will not interfere with this. The emptied vector is handed back
+  // so that its storage is reused for the next batch.
+  Decls.clear();
+  Decls.swap(DeferredDeclsToEmit);
+  return true;
+}
+
+void CodeGenModule::EmitDeferred() {
+  // Emit code for any potentially referenced deferred decls.  Since a
+  // previously unused static decl may become used during the generation of code
+  // for a static function, iterate until no changes are made.
+  //
+  // The decls scheduled while emitting a definition are emitted before the
+  // rest of its batch. This has the advantage that the decls are emitted in a
+  // DFS and related ones are close together, which is convenient for testing.
+  // The DFS uses an explicit stack of batches rather than recursion, as the
+  // chains of lazily emitted definitions can be very deep in large TUs.
+  struct Batch {
+    std::vector<GlobalDecl> Decls;
+    size_t Next = 0;
+  };
+  SmallVector<Batch, 0> Stack;
+  unsigned Depth = 0;
+  auto PushBatch = [&] {
+    if (Depth == Stack.size())
+      Stack.emplace_back();
+    if (!takeDeferredDeclsToEmit(Stack[Depth].Decls))
+      return;
+    Stack[Depth++].Next = 0;
+  };
+
+  PushBatch();
+  while (Depth) {
+    Batch &B = Stack[Depth - 1];
+    if (B.Next == B.Decls.size()) {
+      --Depth;
+      continue;
+    }
+    // Copy the decl; pushing a batch may reallocate the stack.
+    GlobalDecl D = B.Decls[B.Next++];
 
-  for (GlobalDecl &D : CurDeclsToEmit) {
     // Functions declared with the sycl_kernel_entry_point attribute are
     // emitted normally during host compilation. During device compilation,
     // a SYCL kernel caller offload entry point function is generated and
@@ -3445,9 +3477,9 @@ void CodeGenModule::EmitDeferred() {
         if (!FD->getAttr<SYCLKernelEntryPointAttr>()->isInvalidAttr()) {
           // Generate and emit the SYCL kernel caller function.
           EmitSYCLKernelCaller(FD, getContext());
-          // Recurse to emit any symbols directly or indirectly referenced
-          // by the SYCL kernel caller function.
-          EmitDeferred();
+          // Emit any symbols directly or indirectly referenced by the SYCL
+          // kernel caller function next.
+          PushBatch();
         }
         // Do not emit the sycl_kernel_entry_point attributed function.
         continue;
@@ -3486,14 +3518,11 @@ void CodeGenModule::EmitDeferred() {
     // Otherwise, emit the definition and move on to the next one.
     EmitGlobalDefinition(D, GV);
 
-    // If we found out that we need to emit more decls, do that recursively.
-    // This has the advantage that the decls are emitted in a DFS and related
-    // ones are close together, which is convenient for testing.
-    if (!DeferredVTables.empty() || !DeferredDeclsToEmit.empty()) {
-      EmitDeferred();
-      assert(DeferredVTables.empty() && DeferredDeclsToEmit.empty());
-    }
+    // If we found out that we need to emit more decls, do those first.
+    if (!DeferredVTables.empty() || !DeferredDeclsToEmit.empty())
+      PushBatch();
   }
+  assert(DeferredVTables.empty() && DeferredDeclsToEmit.empty());
 }
 
 void CodeGenModule::EmitVTablesOpportunistically() {
@@ -1907,6 +1907,10 @@ private:
   /// Emit any needed decls for which code generation was deferred.
   void EmitDeferred();
 
+  /// Emit the deferred vtables and move the deferred decls to emit into
+  /// \p Decls. Returns false if there are no decls left to emit.
+  bool takeDeferredDeclsToEmit(std::vector<GlobalDecl> &Decls);
+
   /// Try to emit external vtables as available_externally if they have emitted
   /// all inlined virtual functions.  It runs after EmitDeferred() and therefore
   /// is not allowed to create new references to things that need to be emitted
@@ -673,6 +673,7 @@ void Sema::addExternalSource(ExternalSemaSource *E) {
 void Sema::PrintStats() const {
   llvm::errs() << "\n*** Semantic Analysis Stats:\n";
   llvm::errs() << NumSFINAEErrors << " SFINAE diagnostics trapped.\n";
+  PrintTemplateInstantiationStats();
 
   BumpAlloc.PrintStats();
   AnalysisWarnings.PrintStats();
@@ -1270,6 +1271,9 @@ void Sema::ActOnEndOfTranslationUnit() {
     }
   }
 
+  if (llvm::isTimeTraceVerbose())
+    emitTemplateInstantiationStatsTimeTrace();
+
   DiagnoseUnterminatedPragmaAlignPack();
   DiagnoseUnterminatedPragmaAttribute();
   OpenMP().DiagnoseUnterminatedOpenMPDeclareTarget();
@@ -60,6 +60,7 @@ SemaBase::SemaDiagnosticBuilder::getDeviceDeferredDiags() const {
 
 Sema::SemaDiagnosticBuilder SemaBase::Diag(SourceLocation Loc, unsigned DiagID,
                                            bool DeferHint) {
+  ++SemaRef.NumDiagsRequested;
   bool IsError =
       getDiagnostics().getDiagnosticIDs()->isDefaultMappingAsError(DiagID);
   bool ShouldDefer = getLangOpts().CUDA && getLangOpts().GPUDeferDiag &&
@@ -3751,6 +3751,8 @@ QualType Sema::CheckTemplateIdType(TemplateName Name,
       ClassTemplate->AddSpecialization(Decl, InsertPos);
       if (ClassTemplate->isOutOfLine())
         Decl->setLexicalDeclContext(ClassTemplate->getLexicalDeclContext());
+    } else {
+      noteTemplateSpecializationReLookup(Decl);
     }
 
     if (Decl->getSpecializationKind() == TSK_Undeclared &&
@@ -4520,6 +4522,7 @@ Sema::CheckVarTemplateId(VarTemplateDecl *Template, SourceLocation TemplateLoc,
   void *InsertPos = nullptr;
   if (VarTemplateSpecializationDecl *Spec =
           Template->findSpecialization(CTAI.CanonicalConverted, InsertPos)) {
+    noteTemplateSpecializationReLookup(Spec);
     checkSpecializationReachability(TemplateNameLoc, Spec);
     if (Spec->getType()->isUndeducedType()) {
       if (ParsingInitForAutoVars.count(Spec))
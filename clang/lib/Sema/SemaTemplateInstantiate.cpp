@@ -37,8 +37,10 @@
 #include "clang/Sema/TemplateInstCallback.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/TimeProfiler.h"
+#include <chrono>
 #include <optional>
 
 using namespace clang;
@@ -889,6 +891,93 @@ void Sema::InstantiatingTemplate::Clear() {
   }
 }
 
+static uint64_t getSteadyClockNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool Sema::shouldCollectTemplateInstantiationStats() const {
+  return CollectStats || llvm::isTimeTraceVerbose();
+}
+
+Sema::TemplateInstantiationStatScope::TemplateInstantiationStatScope(
+    Sema &S, const NamedDecl *Spec)
+    : S(S),
+      Spec(S.shouldCollectTemplateInstantiationStats() ? Spec : nullptr) {
+  if (this->Spec)
+    StartNs = getSteadyClockNs();
+}
+
+Sema::TemplateInstantiationStatScope::~TemplateInstantiationStatScope() {
+  if (!Spec)
+    return;
+  TemplateInstantiationStat &Stat = S.TemplateInstantiationStats[Spec];
+  ++Stat.NumInstantiations;
+  unsigned Depth = S.CodeSynthesisContexts.size() - S.NonInstantiationEntries;
+  Stat.MaxDepth = std::max(Stat.MaxDepth, Depth);
+  Stat.TimeNs += getSteadyClockNs() - StartNs;
+}
+
+using SpecializationStat =
+    std::pair<const NamedDecl *, Sema::TemplateInstantiationStat>;
+
+/// Returns the specializations in \p Stats that were instantiated, the most
+/// expensive first.
+static SmallVector<SpecializationStat, 0> sortInstantiatedSpecializations(
+    const llvm::MapVector<const NamedDecl *, Sema::TemplateInstantiationStat>
+        &Stats) {
+  SmallVector<SpecializationStat, 0> Specs;
+  for (const SpecializationStat &Entry : Stats)
+    if (Entry.second.NumInstantiations)
+      Specs.push_back(Entry);
+  llvm::stable_sort(Specs, [](const SpecializationStat &A,
+                              const SpecializationStat &B) {
+    return A.second.TimeNs > B.second.TimeNs;
+  });
+  return Specs;
+}
+
+void Sema::PrintTemplateInstantiationStats() const {
+  llvm::errs() << SubstTypeCache.size() << " type substitutions cached, "
+               << NumSubstTypeCacheHits << " reused.\n";
+
+  SmallVector<SpecializationStat, 0> Specs =
+      sortInstantiatedSpecializations(TemplateInstantiationStats);
+  llvm::errs() << Specs.size() << " specializations instantiated";
+  if (Specs.empty()) {
+    llvm::errs() << ".\n";
+    return;
+  }
+  llvm::errs() << ", the most expensive:\n";
+  for (const auto &[Spec, Stat] : ArrayRef(Specs).take_front(10)) {
+    llvm::errs() << "  ";
+    Spec->getNameForDiagnostic(llvm::errs(), getPrintingPolicy(),
+                               /*Qualified=*/true);
+    llvm::errs() << ": " << llvm::format("%.3f", Stat.TimeNs / 1e6) << " ms, "
+                 << Stat.NumInstantiations << " instantiations, "
+                 << Stat.NumReLookups << " re-lookups, depth "
+                 << Stat.MaxDepth << "\n";
+  }
+}
+
+void Sema::emitTemplateInstantiationStatsTimeTrace() const {
+  for (const SpecializationStat &Entry :
+       sortInstantiatedSpecializations(TemplateInstantiationStats)) {
+    llvm::timeTraceAddInstantEvent("TemplateInstantiationStats", [&] {
+      const auto &[Spec, Stat] = Entry;
+      std::string Detail;
+      llvm::raw_string_ostream OS(Detail);
+      Spec->getNameForDiagnostic(OS, getPrintingPolicy(), /*Qualified=*/true);
+      OS << " (time_us=" << Stat.TimeNs / 1000
+         << ", instantiations=" << Stat.NumInstantiations
+         << ", relookups=" << Stat.NumReLookups
+         << ", depth=" << Stat.MaxDepth << ")";
+      return Detail;
+    });
+  }
+}
+
 static std::string convertCallArgsToString(Sema &S,
                                            llvm::ArrayRef<const Expr *> Args) {
   std::string Result;
@@ -3021,6 +3110,99 @@ TypeSourceInfo *Sema::SubstType(TypeLoc TL,
   return TLB.getTypeSourceInfo(Context, Result);
 }
 
+static bool isContextIndependentSubstitution(const TemplateArgument &Arg);
+
+/// Whether \p Name is substituted without looking up the instantiation of a
+/// member template of a dependent context.
+static bool isContextIndependentSubstitution(TemplateName Name) {
+  if (Name.getKind() != TemplateName::Template)
+    return false;
+  TemplateDecl *TD = Name.getAsTemplateDecl();
+  return isa<TemplateTemplateParmDecl>(TD) ||
+         !TD->getDeclContext()->isDependentContext();
+}
+
+/// Whether substituting template arguments into \p T only depends on the
+/// arguments, so that the result can be reused for another substitution of the
+/// same arguments. This excludes types that contain expressions, name members
+/// of dependent types or refer to alias templates, whose substitution depends
+/// on name lookup, access checking and local instantiations in the current
+/// context.
+static bool isContextIndependentSubstitution(QualType T) {
+  if (!T->isInstantiationDependentType())
+    return !T->isVariablyModifiedType();
+
+  switch (T->getTypeClass()) {
+  case Type::TemplateTypeParm:
+    return true;
+  case Type::SubstTemplateTypeParm:
+    return isContextIndependentSubstitution(
+        cast<SubstTemplateTypeParmType>(T)->getReplacementType());
+  case Type::Pointer:
+    return isContextIndependentSubstitution(T->getPointeeType());
+  case Type::LValueReference:
+  case Type::RValueReference:
+    return isContextIndependentSubstitution(
+        cast<ReferenceType>(T)->getPointeeTypeAsWritten());
+  case Type::ConstantArray:
+    if (cast<ConstantArrayType>(T)->getSizeExpr())
+      return false;
+    [[fallthrough]];
+  case Type::IncompleteArray:
+    return isContextIndependentSubstitution(
+        cast<ArrayType>(T)->getElementType());
+  case Type::Paren:
+    return isContextIndependentSubstitution(cast<ParenType>(T)->getInnerType());
+  case Type::Elaborated: {
+    const auto *ET = cast<ElaboratedType>(T);
+    return !ET->getQualifier() &&
+           isContextIndependentSubstitution(ET->getNamedType());
+  }
+  case Type::FunctionProto: {
+    const auto *FPT = cast<FunctionProtoType>(T);
+    if (FPT->getExceptionSpecType() != EST_None ||
+        !FPT->getFunctionEffects().empty())
+      return false;
+    return isContextIndependentSubstitution(FPT->getReturnType()) &&
+           llvm::all_of(FPT->getParamTypes(), [](QualType ParamType) {
+             return isContextIndependentSubstitution(ParamType);
+           });
+  }
+  case Type::TemplateSpecialization: {
+    const auto *TST = cast<TemplateSpecializationType>(T);
+    TemplateName Name = TST->getTemplateName();
+    return isContextIndependentSubstitution(Name) &&
+           isa<ClassTemplateDecl>(Name.getAsTemplateDecl()) &&
+           llvm::all_of(TST->template_arguments(),
+                        [](const TemplateArgument &Arg) {
+                          return isContextIndependentSubstitution(Arg);
+                        });
+  }
+  default:
+    return false;
+  }
+}
+
+static bool isContextIndependentSubstitution(const TemplateArgument &Arg) {
+  switch (Arg.getKind()) {
+  case TemplateArgument::Type:
+    return isContextIndependentSubstitution(Arg.getAsType());
+  case TemplateArgument::Template:
+    return isContextIndependentSubstitution(Arg.getAsTemplate());
+  case TemplateArgument::Declaration:
+  case TemplateArgument::NullPtr:
+  case TemplateArgument::Integral:
+  case TemplateArgument::StructuralValue:
+    return !Arg.isInstantiationDependent();
+  case TemplateArgument::Null:
+  case TemplateArgument::TemplateExpansion:
+  case TemplateArgument::Expression:
+  case TemplateArgument::Pack:
+    return false;
+  }
+  llvm_unreachable("Unhandled TemplateArgument::ArgKind!");
+}
+
 /// Deprecated form of the above.
 QualType Sema::SubstType(QualType T,
                          const MultiLevelTemplateArgumentList &TemplateArgs,
@@ -3035,12 +3217,52 @@ QualType Sema::SubstType(QualType T,
   if (!T->isInstantiationDependentType() && !T->isVariablyModifiedType())
     return T;
 
+  // Reuse the result of an earlier substitution of the same arguments if it
+  // cannot depend on the context. Only substitutions that succeeded without
+  // requesting any diagnostic, including notes and diagnostics suppressed by
+  // the current mapping, are cached, so that the reuse does not lose any.
+  // In a SFINAE context, diagnostics are stored on the deduction info rather
+  // than counted, so the cache is not used there at all.
+  llvm::FoldingSetNodeID ID;
+  void *InsertPos = nullptr;
+  bool Cacheable = getLangOpts().CacheTemplateTypeSubstitutions &&
+                   !IsIncompleteSubstitution && !TemplateArgs.isRewrite() &&
+                   !isSFINAEContext() && isContextIndependentSubstitution(T);
+  if (Cacheable) {
+    ID.AddPointer(T.getAsOpaquePtr());
+    ID.AddInteger(ArgPackSubstIndex.toInternalRepresentation());
+    ID.AddInteger(TemplateArgs.getNumRetainedOuterLevels());
+    for (const auto &Level : TemplateArgs) {
+      ID.AddPointer(Level.AssociatedDeclAndFinal.getOpaqueValue());
+      ID.AddInteger(Level.Args.size());
+      for (const TemplateArgument &Arg : Level.Args)
+        Arg.Profile(ID, Context);
+    }
+    if (SubstTypeCacheEntry *Entry =
+            SubstTypeCache.FindNodeOrInsertPos(ID, InsertPos)) {
+      ++NumSubstTypeCacheHits;
+      return Entry->Result;
+    }
+  }
+  unsigned NumErrors = getDiagnostics().getNumErrors();
+  unsigned NumWarnings = getDiagnostics().getNumWarnings();
+  unsigned PrevDiagsRequested = NumDiagsRequested;
+
   TemplateInstantiator Instantiator(
       *this, TemplateArgs, Loc, Entity,
       /*BailOutOnIncomplete=*/IsIncompleteSubstitution != nullptr);
   QualType QT = Instantiator.TransformType(T);
   if (IsIncompleteSubstitution && Instantiator.getIsIncomplete())
     *IsIncompleteSubstitution = true;
+
+  if (Cacheable && !QT.isNull() &&
+      NumErrors == getDiagnostics().getNumErrors() &&
+      NumWarnings == getDiagnostics().getNumWarnings() &&
+      PrevDiagsRequested == NumDiagsRequested) {
+    auto *Entry = BumpAlloc.Allocate<SubstTypeCacheEntry>();
+    SubstTypeCache.InsertNode(new (Entry) SubstTypeCacheEntry(ID, QT),
+                              InsertPos);
+  }
   return QT;
 }
 
@@ -3636,6 +3858,7 @@ Sema::InstantiateClass(SourceLocation PointOfInstantiation,
   if (Inst.isInvalid())
     return true;
   assert(!Inst.isAlreadyInstantiating() && "should have been caught by caller");
+  TemplateInstantiationStatScope StatScope(*this, Instantiation);
   PrettyDeclStackTraceEntry CrashInfo(Context, Instantiation, SourceLocation(),
                                       "instantiating class definition");
 
@@ -2645,8 +2645,10 @@ Decl *TemplateDeclInstantiator::VisitFunctionDecl(
       = FunctionTemplate->findSpecialization(Innermost, InsertPos);
 
     // If we already have a function template specialization, return it.
-    if (SpecFunc)
+    if (SpecFunc) {
+      SemaRef.noteTemplateSpecializationReLookup(SpecFunc);
       return SpecFunc;
+    }
   }
 
   bool MergeWithParentScope = (TemplateParams != nullptr) ||
@@ -3013,8 +3015,10 @@ Decl *TemplateDeclInstantiator::VisitCXXMethodDecl(
       = FunctionTemplate->findSpecialization(Innermost, InsertPos);
 
     // If we already have a function template specialization, return it.
-    if (SpecFunc)
+    if (SpecFunc) {
+      SemaRef.noteTemplateSpecializationReLookup(SpecFunc);
       return SpecFunc;
+    }
   }
 
   bool isFriend;
@@ -5455,8 +5459,10 @@ void Sema::InstantiateFunctionDefinition(SourceLocation PointOfInstantiation,
   const FunctionDecl *ExistingDefn = nullptr;
   if (Function->isDefined(ExistingDefn,
                           /*CheckForPendingFriendDefinition=*/true)) {
-    if (ExistingDefn->isThisDeclarationADefinition())
+    if (ExistingDefn->isThisDeclarationADefinition()) {
+      noteTemplateSpecializationReLookup(Function);
       return;
+    }
 
     // If we're asked to instantiate a function whose body comes from an
     // instantiated friend declaration, attach the instantiated body to the
@@ -5606,6 +5612,7 @@ void Sema::InstantiateFunctionDefinition(SourceLocation PointOfInstantiation,
   InstantiatingTemplate Inst(*this, PointOfInstantiation, Function);
   if (Inst.isInvalid() || Inst.isAlreadyInstantiating())
     return;
+  TemplateInstantiationStatScope StatScope(*this, Function);
   PrettyDeclStackTraceEntry CrashInfo(Context, Function, SourceLocation(),
                                       "instantiating function definition");
 
@@ -6291,12 +6298,14 @@ void Sema::InstantiateVariableDefinition(SourceLocation PointOfInstantiation,
     // instantiated.
     Def->setTemplateSpecializationKind(Var->getTemplateSpecializationKind(),
                                        PointOfInstantiation);
+    noteTemplateSpecializationReLookup(Var);
     return;
   }
 
   InstantiatingTemplate Inst(*this, PointOfInstantiation, Var);
   if (Inst.isInvalid() || Inst.isAlreadyInstantiating())
     return;
+  TemplateInstantiationStatScope StatScope(*this, Var);
   PrettyDeclStackTraceEntry CrashInfo(Context, Var, SourceLocation(),
                                       "instantiating variable definition");
 
@@ -8563,6 +8563,18 @@ bool ASTReader::FindExternalVisibleDeclsByName(const DeclContext *DC,
 
   Deserializing LookupResults(this);
 
+  // If the global module index is up to date for every module file we have
+  // loaded and none of them has this identifier, none of the lookup tables
+  // for DC has an entry for it. Answer from the index instead of probing the
+  // table of each module file that extends DC.
+  if (const IdentifierInfo *II = Name.getAsIdentifierInfo();
+      II && ModuleMgr.isFullyCoveredByGlobalIndex() &&
+      !GlobalIndex->hasIdentifier(II->getName())) {
+    ++NumVisibleDeclContextLookupsSkipped;
+    SetExternalVisibleDeclsForName(DC, Name, Decls);
+    return false;
+  }
+
   // FIXME: Clear the redundancy with templated lambda in C++20 when that's
   // available.
   if (auto It = Lookups.find(DC); It != Lookups.end()) {
@@ -8764,6 +8776,11 @@ void ASTReader::PrintStats() {
                  NumTULocalVisibleDeclContexts, TotalTULocalVisibleDeclContexts,
                  ((float)NumTULocalVisibleDeclContexts /
                   TotalTULocalVisibleDeclContexts * 100));
+  if (NumVisibleDeclContextLookupsSkipped)
+    std::fprintf(stderr,
+                 "  %u visible declcontext lookups answered by the global "
+                 "module index\n",
+                 NumVisibleDeclContextLookupsSkipped);
   if (TotalNumMethodPoolEntries)
     std::fprintf(stderr, "  %u/%u method pool entries read (%f%%)\n",
                  NumMethodPoolEntriesRead, TotalNumMethodPoolEntries,
@@ -324,6 +324,21 @@ bool GlobalModuleIndex::lookupIdentifier(StringRef Name, HitSet &Hits) {
   return true;
 }
 
+bool GlobalModuleIndex::hasIdentifier(StringRef Name) {
+  // Without an identifier index, we can't rule anything out.
+  if (!IdentifierIndex)
+    return true;
+
+  ++NumDeclNameLookups;
+  IdentifierIndexTable &Table
+    = *static_cast<IdentifierIndexTable *>(IdentifierIndex);
+  if (Table.find(Name) != Table.end())
+    return true;
+
+  ++NumDeclNameLookupMisses;
+  return false;
+}
+
 bool GlobalModuleIndex::loadedModuleFile(ModuleFile *File) {
   // Look for the module in the global module index based on the module name.
   StringRef Name = File->ModuleName;
@@ -358,6 +373,11 @@ void GlobalModuleIndex::printStats() {
             NumIdentifierLookupHits, NumIdentifierLookups,
             (double)NumIdentifierLookupHits*100.0/NumIdentifierLookups);
   }
+  if (NumDeclNameLookups) {
+    fprintf(stderr, "  %u / %u declaration name lookups ruled out (%f%%)\n",
+            NumDeclNameLookupMisses, NumDeclNameLookups,
+            (double)NumDeclNameLookupMisses*100.0/NumDeclNameLookups);
+  }
   std::fprintf(stderr, "\n");
 }
 
@@ -7,8 +7,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h"
+#include "clang/Basic/TokenKinds.h"
+#include "clang/Basic/Version.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 #include <optional>
 
 using namespace clang;
@@ -61,6 +65,14 @@ bool DependencyScanningWorkerFilesystem::ensureDirectiveTokensArePopulated(
     return true;
 
   SmallVector<dependency_directives_scan::Directive, 64> Directives;
+  // Reuse the directives saved by a previous process if the file is unchanged.
+  if (SharedCache.getSavedDependencyDirectives(
+          Entry.getStatus(), Contents->DepDirectiveTokens, Directives)) {
+    Contents->DepDirectives.store(
+        new std::optional<DependencyDirectivesTy>(std::move(Directives)));
+    return true;
+  }
+
   // Scan the file for preprocessor directives that might affect the
   // dependencies.
   if (scanSourceForDependencyDirectives(Contents->Original->getBuffer(),
@@ -142,6 +154,256 @@ DependencyScanningFilesystemSharedCache::getOutOfDateEntries(
   return InvalidDiagInfo;
 }
 
+// The file written by saveDependencyDirectives() is only meant to be read by
+// the same version of clang on the same machine. It starts with the magic
+// string, the format version, the clang version and the number of entries,
+// followed by a record for each entry:
+//
+//   device, file, modification time (ns), size: uint64_t each
+//   number of tokens, number of directives: uint32_t each
+//   number of saves since the entry was last used: uint32_t
+//
+// followed by the tokens and directives of each entry, in the same order:
+//
+//   token: offset, length: uint32_t each; kind, flags: uint16_t each
+//   directive: kind: uint8_t; first token, number of tokens: uint32_t each
+//
+// All integers are little-endian. Bump DirectivesFileFormatVersion whenever
+// the layout above or the meaning of the serialized token and directive kinds
+// changes without a change of the clang version.
+static constexpr llvm::StringLiteral DirectivesFileMagic = "CLDEPDIR";
+static constexpr uint32_t DirectivesFileFormatVersion = 2;
+static constexpr size_t DirectivesFileEntrySize = 4 * 8 + 3 * 4;
+static constexpr size_t DirectivesFileTokenSize = 2 * 4 + 2 * 2;
+static constexpr size_t DirectivesFileDirectiveSize = 1 + 2 * 4;
+
+// An entry that was not used by this many consecutive saves is dropped, so
+// that the entries of deleted or replaced files do not accumulate.
+static constexpr uint32_t DirectivesFileMaxUnusedSaves = 8;
+
+void DependencyScanningFilesystemSharedCache::loadDependencyDirectives(
+    StringRef Path) {
+  using namespace llvm::support;
+  SavedDirectives.clear();
+  SavedDirectivesBuffer.reset();
+
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(
+      Path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+  if (!MaybeBuffer)
+    return;
+  StringRef Data = (*MaybeBuffer)->getBuffer();
+  if (!Data.consume_front(DirectivesFileMagic))
+    return;
+
+  // Reads an integer or a string, or returns false at the end of the buffer.
+  auto Read = [&](auto &Value) {
+    using T = std::remove_reference_t<decltype(Value)>;
+    if (Data.size() < sizeof(T))
+      return false;
+    Value = endian::read<T, llvm::endianness::little>(Data.data());
+    Data = Data.drop_front(sizeof(T));
+    return true;
+  };
+  auto ReadString = [&](uint32_t Size, StringRef &Value) {
+    if (Data.size() < Size)
+      return false;
+    Value = Data.take_front(Size);
+    Data = Data.drop_front(Size);
+    return true;
+  };
+
+  uint32_t FormatVersion, VersionSize;
+  StringRef Version;
+  uint64_t NumEntries;
+  if (!Read(FormatVersion) || FormatVersion != DirectivesFileFormatVersion ||
+      !Read(VersionSize) || !ReadString(VersionSize, Version) ||
+      Version != getClangFullVersion() || !Read(NumEntries) ||
+      NumEntries > Data.size() / DirectivesFileEntrySize)
+    return;
+
+  // The tokens and directives follow the entry records. Check that the
+  // entries cover exactly the rest of the file.
+  uint64_t Offset = (*MaybeBuffer)->getBufferSize() - Data.size() +
+                    NumEntries * DirectivesFileEntrySize;
+  for (uint64_t I = 0; I != NumEntries; ++I) {
+    uint64_t Device, File, Size;
+    int64_t ModificationTime;
+    uint32_t NumTokens, NumDirectives, UnusedSaves;
+    if (!Read(Device) || !Read(File) || !Read(ModificationTime) ||
+        !Read(Size) || !Read(NumTokens) || !Read(NumDirectives) ||
+        !Read(UnusedSaves)) {
+      SavedDirectives.clear();
+      return;
+    }
+    SavedDirectivesEntry &Entry =
+        SavedDirectives[llvm::sys::fs::UniqueID(Device, File)];
+    Entry.ModificationTime =
+        llvm::sys::TimePoint<>(std::chrono::nanoseconds(ModificationTime));
+    Entry.Size = Size;
+    Entry.TokensOffset = Offset;
+    Entry.NumTokens = NumTokens;
+    Offset += uint64_t(NumTokens) * DirectivesFileTokenSize;
+    Entry.DirectivesOffset = Offset;
+    Entry.NumDirectives = NumDirectives;
+    Offset += uint64_t(NumDirectives) * DirectivesFileDirectiveSize;
+    Entry.UnusedSaves = UnusedSaves;
+    if (Offset > (*MaybeBuffer)->getBufferSize()) {
+      SavedDirectives.clear();
+      return;
+    }
+  }
+  if (Offset != (*MaybeBuffer)->getBufferSize()) {
+    SavedDirectives.clear();
+    return;
+  }
+  SavedDirectivesBuffer = std::move(*MaybeBuffer);
+}
+
+bool DependencyScanningFilesystemSharedCache::getSavedDependencyDirectives(
+    const llvm::vfs::Status &Stat,
+    SmallVectorImpl<dependency_directives_scan::Token> &Tokens,
+    SmallVectorImpl<dependency_directives_scan::Directive> &Directives) const {
+  using namespace llvm::support;
+  using namespace dependency_directives_scan;
+  auto It = SavedDirectives.find(Stat.getUniqueID());
+  if (It == SavedDirectives.end())
+    return false;
+  const SavedDirectivesEntry &Entry = It->second;
+  if (Entry.Size != Stat.getSize() ||
+      Entry.ModificationTime != Stat.getLastModificationTime())
+    return false;
+
+  // The contents of the file are not checked, so reject anything that could
+  // make the lexer read outside of the file.
+  const char *Ptr =
+      SavedDirectivesBuffer->getBufferStart() + Entry.TokensOffset;
+  Tokens.clear();
+  Tokens.reserve(Entry.NumTokens);
+  for (uint32_t I = 0; I != Entry.NumTokens; ++I) {
+    auto Offset = endian::readNext<uint32_t, llvm::endianness::little>(Ptr);
+    auto Length = endian::readNext<uint32_t, llvm::endianness::little>(Ptr);
+    auto Kind = endian::readNext<uint16_t, llvm::endianness::little>(Ptr);
+    auto Flags = endian::readNext<uint16_t, llvm::endianness::little>(Ptr);
+    if (uint64_t(Offset) + Length > Entry.Size || Kind >= tok::NUM_TOKENS) {
+      Tokens.clear();
+      return false;
+    }
+    Tokens.emplace_back(Offset, Length, tok::TokenKind(Kind), Flags);
+  }
+
+  Directives.clear();
+  Directives.reserve(Entry.NumDirectives);
+  Ptr = SavedDirectivesBuffer->getBufferStart() + Entry.DirectivesOffset;
+  for (uint32_t I = 0; I != Entry.NumDirectives; ++I) {
+    auto Kind = endian::readNext<uint8_t, llvm::endianness::little>(Ptr);
+    auto First = endian::readNext<uint32_t, llvm::endianness::little>(Ptr);
+    auto Count = endian::readNext<uint32_t, llvm::endianness::little>(Ptr);
+    if (Kind > pp_eof || uint64_t(First) + Count > Tokens.size()) {
+      Tokens.clear();
+      Directives.clear();
+      return false;
+    }
+    Directives.emplace_back(DirectiveKind(Kind),
+                            ArrayRef(Tokens).slice(First, Count));
+  }
+  return true;
+}
+
+llvm::Error DependencyScanningFilesystemSharedCache::saveDependencyDirectives(
+    StringRef Path) const {
+  using namespace llvm::support;
+  using namespace dependency_directives_scan;
+
+  // The status and contents of the files that were scanned by this process.
+  llvm::DenseMap<llvm::sys::fs::UniqueID,
+                 std::pair<llvm::vfs::Status, CachedFileContents *>>
+      Scanned;
+  for (unsigned I = 0; I < NumShards; ++I) {
+    const CacheShard &Shard = CacheShards[I];
+    std::lock_guard<std::mutex> LockGuard(Shard.CacheLock);
+    for (const auto &[UID, Entry] : Shard.EntriesByUID) {
+      if (Entry->isError() || Entry->isDirectory())
+        continue;
+      CachedFileContents *Contents = Entry->getCachedContents();
+      if (!Contents)
+        continue;
+      const auto *Directives = Contents->DepDirectives.load();
+      if (Directives && Directives->has_value())
+        Scanned.try_emplace(UID, Entry->getStatus(), Contents);
+    }
+  }
+
+  // Files loaded from disk that were not scanned again are kept, unless they
+  // have not been used for too long.
+  SmallVector<std::pair<llvm::sys::fs::UniqueID, const SavedDirectivesEntry *>,
+              0>
+      Kept;
+  for (const auto &[UID, Entry] : SavedDirectives)
+    if (!Scanned.count(UID) &&
+        Entry.UnusedSaves < DirectivesFileMaxUnusedSaves - 1)
+      Kept.emplace_back(UID, &Entry);
+
+  return llvm::writeToOutput(Path, [&](raw_ostream &OS) {
+    endian::Writer W(OS, llvm::endianness::little);
+    std::string Version = getClangFullVersion();
+    OS << DirectivesFileMagic;
+    W.write<uint32_t>(DirectivesFileFormatVersion);
+    W.write<uint32_t>(Version.size());
+    OS << Version;
+    W.write<uint64_t>(Scanned.size() + Kept.size());
+
+    auto WriteEntry = [&](llvm::sys::fs::UniqueID UID,
+                          llvm::sys::TimePoint<> ModificationTime,
+                          uint64_t Size, uint32_t NumTokens,
+                          uint32_t NumDirectives, uint32_t UnusedSaves) {
+      W.write<uint64_t>(UID.getDevice());
+      W.write<uint64_t>(UID.getFile());
+      W.write<int64_t>(
+          std::chrono::nanoseconds(ModificationTime.time_since_epoch())
+              .count());
+      W.write<uint64_t>(Size);
+      W.write<uint32_t>(NumTokens);
+      W.write<uint32_t>(NumDirectives);
+      W.write<uint32_t>(UnusedSaves);
+    };
+    for (const auto &[UID, Value] : Scanned) {
+      const auto &[Stat, Contents] = Value;
+      WriteEntry(UID, Stat.getLastModificationTime(), Stat.getSize(),
+                 Contents->DepDirectiveTokens.size(),
+                 (*Contents->DepDirectives.load())->size(), 0);
+    }
+    for (const auto &[UID, Entry] : Kept)
+      WriteEntry(UID, Entry->ModificationTime, Entry->Size, Entry->NumTokens,
+                 Entry->NumDirectives, Entry->UnusedSaves + 1);
+
+    for (const auto &[UID, Value] : Scanned) {
+      CachedFileContents *Contents = Value.second;
+      ArrayRef<Token> Tokens = Contents->DepDirectiveTokens;
+      for (const Token &T : Tokens) {
+        W.write<uint32_t>(T.Offset);
+        W.write<uint32_t>(T.Length);
+        W.write<uint16_t>(T.Kind);
+        W.write<uint16_t>(T.Flags);
+      }
+      for (const Directive &D : **Contents->DepDirectives.load()) {
+        W.write<uint8_t>(D.Kind);
+        W.write<uint32_t>(D.Tokens.empty() ? 0
+                                           : D.Tokens.data() - Tokens.data());
+        W.write<uint32_t>(D.Tokens.size());
+      }
+    }
+    StringRef Saved = SavedDirectivesBuffer
+                          ? SavedDirectivesBuffer->getBuffer()
+                          : StringRef();
+    for (const auto &[UID, Entry] : Kept)
+      OS << Saved.substr(Entry->TokensOffset,
+                         Entry->NumTokens * DirectivesFileTokenSize +
+                             Entry->NumDirectives *
+                                 DirectivesFileDirectiveSize);
+    return llvm::Error::success();
+  });
+}
+
 const CachedFileSystemEntry *
 DependencyScanningFilesystemSharedCache::CacheShard::findEntryByFilename(
     StringRef Filename) const {
@@ -0,0 +1,168 @@
+// Test that a clang-scan-deps daemon only rescans the translation units whose
+// files changed, including files reached through a symlink.
+
+// UNSUPPORTED: system-windows
+
+// RUN: rm -rf %t && split-file %s %t && cd %t
+// RUN: sed -e "s|DIR|%/t|g" cdb.json.in > cdb.json
+// RUN: ln -s ../real/target.h src/link.h
+
+// The idle timeout stops the daemon if a RUN line fails before it is shut down.
+// RUN: %python start.py sock clang-scan-deps -compilation-database cdb.json \
+// RUN:   -format experimental-full -daemon=sock -daemon-idle-timeout=120 -v
+
+// RUN: clang-scan-deps -connect=sock -o out1.json
+// RUN: echo "== 1" >> daemon.log
+// RUN: FileCheck %s -DPREFIX=%/t --check-prefix=OUT1 --input-file=out1.json
+
+// OUT1: "[[PREFIX]]/src/a.h"
+// OUT1: "[[PREFIX]]/src/b.h"
+// OUT1: "[[PREFIX]]/src/link.h"
+
+// RUN: echo '#include "c.h"' > src/a.h
+// RUN: clang-scan-deps -connect=sock -o out2.json
+// RUN: echo "== 2" >> daemon.log
+// RUN: FileCheck %s -DPREFIX=%/t --check-prefix=OUT2 --input-file=out2.json
+
+// OUT2: "[[PREFIX]]/src/a.h"
+// OUT2: "[[PREFIX]]/src/c.h"
+// OUT2: "[[PREFIX]]/src/b.h"
+
+// The directory of real/target.h is not watched, since no dependency is
+// reported there, but the edit is still noticed. The outputs are written
+// outside of src/, so that they are not mistaken for new headers.
+// RUN: echo '#include "d.h"' > real/target.h
+// RUN: clang-scan-deps -connect=sock -o out3.json
+// RUN: echo "== 3" >> daemon.log
+// RUN: FileCheck %s -DPREFIX=%/t --check-prefix=OUT3 --input-file=out3.json
+
+// OUT3: "[[PREFIX]]/src/link.h"
+// OUT3: "[[PREFIX]]/src/d.h"
+
+// RUN: clang-scan-deps -connect=sock -shutdown-daemon
+// RUN: %python stop.py 60
+// RUN: FileCheck %s -DPREFIX=%/t --check-prefix=LOG --input-file=daemon.log
+
+// The initial scan scans everything.
+// LOG:      Scanning [[PREFIX]]/src/tu1.c
+// LOG-NEXT: Scanning [[PREFIX]]/src/tu2.c
+// LOG-NEXT: Scanning [[PREFIX]]/src/tu3.c
+// LOG-NEXT: Scanned 3 files, listening on 'sock'
+// LOG-NEXT: == 1
+// A late event from the directory watcher may rescan tu1.c again, but the
+// other translation units are never rescanned.
+// LOG-NOT:  tu2.c
+// LOG-NOT:  tu3.c
+// LOG:      Scanning [[PREFIX]]/src/tu1.c
+// LOG-NOT:  tu2.c
+// LOG-NOT:  tu3.c
+// LOG:      == 2
+// LOG-NOT:  tu2.c
+// LOG:      Scanning [[PREFIX]]/src/tu3.c
+// LOG-NOT:  tu2.c
+// LOG:      == 3
+// LOG-NOT:  No request in
+
+// Without requests, the daemon exits on its own after the idle timeout.
+// RUN: %python start.py sock2 clang-scan-deps -compilation-database cdb.json \
+// RUN:   -format experimental-full -daemon=sock2 -daemon-idle-timeout=1 -v
+// RUN: %python stop.py 60
+// RUN: FileCheck %s --check-prefix=IDLE --input-file=daemon.log
+
+// IDLE: listening on 'sock2'
+// IDLE-NEXT: No request in 1 seconds, shutting down
+
+//--- start.py
+# Starts the daemon listening on the socket given as the first argument in the
+# background, appending its errors to daemon.log, records its PID in
+# daemon.pid and waits until it listens on its socket.
+import os
+import subprocess
+import sys
+import time
+
+with open("daemon.log", "ab") as log:
+    daemon = subprocess.Popen(
+        sys.argv[2:],
+        stdin=subprocess.DEVNULL,
+        stdout=subprocess.DEVNULL,
+        stderr=log,
+        start_new_session=True,
+    )
+with open("daemon.pid", "w") as f:
+    f.write(str(daemon.pid))
+for _ in range(600):
+    if os.path.exists(sys.argv[1]):
+        sys.exit(0)
+    if daemon.poll() is not None:
+        sys.exit("the daemon exited")
+    time.sleep(0.1)
+daemon.kill()
+sys.exit("the daemon did not start")
+
+//--- stop.py
+# Waits up to the given number of seconds for the daemon recorded in
+# daemon.pid to exit, and kills its session and fails if it does not.
+import os
+import signal
+import sys
+import time
+
+
+def running(pid):
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    # The daemon is not a child of this script, and may linger as a zombie
+    # until its new parent reaps it.
+    try:
+        with open("/proc/%d/stat" % pid) as f:
+            return f.read().rsplit(")", 1)[1].split()[0] != "Z"
+    except OSError:
+        return True
+
+
+with open("daemon.pid") as f:
+    pid = int(f.read())
+os.remove("daemon.pid")
+for _ in range(int(sys.argv[1]) * 10):
+    if not running(pid):
+        sys.exit(0)
+    time.sleep(0.1)
+os.killpg(pid, signal.SIGKILL)
+sys.exit("the daemon did not exit")
+
+//--- cdb.json.in
+[
+  {
+    "directory": "DIR",
+    "command": "clang -c DIR/src/tu1.c -o DIR/src/tu1.o",
+    "file": "DIR/src/tu1.c"
+  },
+  {
+    "directory": "DIR",
+    "command": "clang -c DIR/src/tu2.c -o DIR/src/tu2.o",
+    "file": "DIR/src/tu2.c"
+  },
+  {
+    "directory": "DIR",
+    "command": "clang -c DIR/src/tu3.c -o DIR/src/tu3.o",
+    "file": "DIR/src/tu3.c"
+  }
+]
+
+//--- src/tu1.c
+#include "a.h"
+
+//--- src/tu2.c
+#include "b.h"
+
+//--- src/tu3.c
+#include "link.h"
+
+//--- src/a.h
+//--- src/b.h
+//--- src/c.h
+//--- src/d.h
+//--- real/target.h
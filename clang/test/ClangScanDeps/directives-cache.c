@@ -0,0 +1,76 @@
+// Test that -directives-cache= reuses the dependency directives of unchanged
+// files across runs, and ignores a cache file from another version or a
+// corrupt one.
+
+// RUN: rm -rf %t && split-file %s %t
+// RUN: sed -e "s|DIR|%/t|g" %t/cdb.json.in > %t/cdb.json
+// RUN: touch -r %t/header.h %t/stamp
+
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=A --implicit-check-not=/b.h
+// RUN: cp %t/cache.bin %t/good.bin
+
+// A:      [[PREFIX]]/tu.c
+// A:      [[PREFIX]]/header.h
+// A:      [[PREFIX]]/a.h
+
+// Edit header.h in place. It keeps its unique ID, size and modification
+// time, so the saved directives, which include "a.h", are still used.
+// RUN: %python -c "import sys; p = sys.argv[1]; d = open(p, 'rb').read(); open(p, 'wb').write(d.replace(b'a.h', b'b.h'))" %t/header.h
+// RUN: touch -r %t/stamp %t/header.h
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=A --implicit-check-not=/b.h
+
+// Without the cache, the file is scanned again.
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=B --implicit-check-not=/a.h
+
+// B:      [[PREFIX]]/tu.c
+// B:      [[PREFIX]]/header.h
+// B:      [[PREFIX]]/b.h
+
+// A cache file written by another version of clang is ignored.
+// RUN: %python -c "import sys; p = sys.argv[1]; d = open(p, 'rb').read(); open(sys.argv[2], 'wb').write(d.replace(b'clang version', b'clang versioX'))" %t/good.bin %t/cache.bin
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=B --implicit-check-not=/a.h
+
+// So is a cache file with another format version.
+// RUN: %python -c "import sys; p = sys.argv[1]; d = open(p, 'rb').read(); open(sys.argv[2], 'wb').write(d[:8] + b'\xff' + d[9:])" %t/good.bin %t/cache.bin
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=B --implicit-check-not=/a.h
+
+// A truncated or otherwise corrupt cache file is ignored and replaced.
+// RUN: %python -c "import sys; p = sys.argv[1]; d = open(p, 'rb').read(); open(sys.argv[2], 'wb').write(d[:-1])" %t/good.bin %t/cache.bin
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=B --implicit-check-not=/a.h
+// RUN: echo "CLDEPDIR garbage" > %t/cache.bin
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=B --implicit-check-not=/a.h
+// RUN: clang-scan-deps -compilation-database %t/cdb.json -format make \
+// RUN:   -directives-cache=%t/cache.bin \
+// RUN:   | FileCheck %s -DPREFIX=%/t --check-prefix=B --implicit-check-not=/a.h
+
+//--- cdb.json.in
+[{
+  "directory": "DIR",
+  "command": "clang -c DIR/tu.c -o DIR/tu.o",
+  "file": "DIR/tu.c"
+}]
+
+//--- tu.c
+#include "header.h"
+
+//--- header.h
+#include "a.h"
+
+//--- a.h
+
+//--- b.h
+
+//--- stamp
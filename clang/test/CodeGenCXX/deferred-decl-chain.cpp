@@ -0,0 +1,26 @@
+// A chain of 100000 inline functions, each one only referenced by the
+// previous one, is emitted lazily one link at a time. Emitting it must not
+// need native stack space proportional to the length of the chain.
+
+// RUN: rm -rf %t && split-file %s %t
+// RUN: %python %t/gen.py 100000 > %t/chain.cpp
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -emit-llvm %t/chain.cpp -o %t/chain.ll
+// RUN: FileCheck %s --input-file=%t/chain.ll
+
+// The definitions are emitted in the order in which they are reached.
+// CHECK:      define{{.*}} void @_Z3usev()
+// CHECK:      define linkonce_odr void @_Z2f0v()
+// CHECK-NEXT: entry:
+// CHECK-NEXT:   call void @_Z2f1v()
+// CHECK:      define linkonce_odr void @_Z2f1v()
+// CHECK:      define linkonce_odr void @_Z6f99999v()
+// CHECK:      define linkonce_odr void @_Z7f100000v()
+
+//--- gen.py
+import sys
+
+n = int(sys.argv[1])
+print("inline void f%d() {}" % n)
+for i in reversed(range(n)):
+    print("inline void f%d() { f%d(); }" % (i, i + 1))
+print("void use() { f0(); }")
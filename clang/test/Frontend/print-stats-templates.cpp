@@ -0,0 +1,14 @@
+// RUN: %clang_cc1 -std=c++17 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+template <typename T> struct S { T t; };
+template <typename T> T f(T x) { return x; }
+
+S<int> a;
+S<int> b;
+int x = f(1) + f(2);
+
+// CHECK: *** Semantic Analysis Stats:
+// CHECK: type substitutions cached, {{[0-9]+}} reused.
+// CHECK: 2 specializations instantiated, the most expensive:
+// CHECK-DAG: S<int>: {{[0-9.]+}} ms, 1 instantiations, {{[1-9][0-9]*}} re-lookups, depth 1
+// CHECK-DAG: f<int>: {{[0-9.]+}} ms, 1 instantiations, {{[1-9][0-9]*}} re-lookups, depth 1
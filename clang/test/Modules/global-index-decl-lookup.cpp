@@ -0,0 +1,73 @@
+// The global module index answers name lookups into DeclContexts extended by
+// module files for names that no module file has, but only when it covers all
+// loaded module files.
+
+// RUN: rm -rf %t && split-file %s %t
+
+// Build the module and the global module index.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t -fsyntax-only %t/use.cpp -verify
+// RUN: ls %t/cache | grep modules.idx
+
+// Names declared in the module are still found. The lookup of only_here is
+// answered by the index.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t -fsyntax-only %t/use.cpp -verify \
+// RUN:   -print-stats 2>&1 | FileCheck %s --check-prefix=INDEX
+
+// INDEX: *** AST File Statistics:
+// INDEX: {{[1-9][0-9]*}} visible declcontext lookups answered by the global module index
+// INDEX: *** Global Module Index Statistics:
+
+// A PCH is not covered by the index, so all lookups use the tables of each
+// module file, and the names declared in the PCH are found.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t -x c++-header -emit-pch \
+// RUN:   %t/pch.h -o %t/pch.pch
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t -include-pch %t/pch.pch \
+// RUN:   -fsyntax-only %t/use-pch.cpp -verify -print-stats 2>&1 | \
+// RUN:   FileCheck %s --check-prefix=PCH
+
+// PCH: *** AST File Statistics:
+// PCH-NOT: answered by the global module index
+
+//--- module.modulemap
+module A { header "a.h" }
+
+//--- a.h
+namespace ns {
+void from_a();
+}
+
+//--- use.cpp
+// expected-no-diagnostics
+#include "a.h"
+
+namespace ns {
+void only_here();
+}
+
+void test() {
+  ns::from_a();
+  ns::only_here();
+}
+
+//--- pch.h
+namespace ns {
+void from_pch();
+}
+
+//--- use-pch.cpp
+// expected-no-diagnostics
+#include "a.h"
+
+namespace ns {
+void only_here();
+}
+
+void test() {
+  ns::from_a();
+  ns::from_pch();
+  ns::only_here();
+}
@@ -0,0 +1,52 @@
+// Reusing a cached substitution must not change the diagnostics.
+// RUN: not %clang_cc1 -std=c++98 -fsyntax-only -Wconversion %s 2> %t.miss
+// RUN: not %clang_cc1 -std=c++98 -fsyntax-only -Wconversion \
+// RUN:   -fcache-template-type-substitutions %s 2> %t.hit
+// RUN: diff %t.miss %t.hit
+// RUN: FileCheck %s < %t.hit
+
+// Substitutions that do not produce any diagnostic are reused.
+// RUN: %clang_cc1 -std=c++17 -fsyntax-only -print-stats -DREUSE \
+// RUN:   -fcache-template-type-substitutions %s 2>&1 | FileCheck %s --check-prefix=STATS
+// RUN: %clang_cc1 -std=c++17 -fsyntax-only -print-stats -DREUSE %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NOCACHE
+
+#ifndef REUSE
+
+// An error with notes, produced by every substitution of 'T *'.
+template <class T, T *V> struct P {};
+P<int &, 0> p1;
+P<int &, 0> p2;
+
+// CHECK: error: 'V' declared as a pointer to a reference of type 'int &'
+// CHECK: note: while substituting prior template arguments into non-type template parameter 'V'
+// CHECK: error: 'V' declared as a pointer to a reference of type 'int &'
+// CHECK: note: while substituting prior template arguments into non-type template parameter 'V'
+
+// A warning, produced by the default argument whenever 'S<T> *' is
+// substituted. It is first suppressed in the SFINAE context of deducing the
+// arguments of g, and must still be emitted for each use of Q afterwards.
+template <class T, unsigned char C = sizeof(T) * 100> struct S {};
+template <class T, S<T> *P> void g() {}
+template <class T, S<T> *P> struct Q {};
+
+S<int> obj;
+void use() {
+  g<int, &obj>();
+  Q<int, &obj> q1;
+  Q<int, &obj> q2;
+}
+
+// CHECK-COUNT-3: warning: non-type template argument value '400' truncated to '144' for template parameter of type 'unsigned char'
+
+#else
+
+template <class T, T V> struct C {};
+C<int, 1> c1;
+C<int, 2> c2;
+C<int, 3> c3;
+
+// STATS: type substitutions cached, {{[1-9][0-9]*}} reused.
+// NOCACHE: 0 type substitutions cached, 0 reused.
+
+#endif
@@ -6,6 +6,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "clang/DirectoryWatcher/DirectoryWatcher.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
 #include "clang/Frontend/CompilerInstance.h"
@@ -17,6 +18,7 @@
 #include "clang/Tooling/JSONCompilationDatabase.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileUtilities.h"
@@ -31,7 +33,9 @@
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_socket_stream.h"
 #include "llvm/TargetParser/Host.h"
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -94,6 +98,11 @@ static bool DeprecatedDriverCommand;
 static ResourceDirRecipeKind ResourceDirRecipe;
 static bool Verbose;
 static bool PrintTiming;
+static std::string DirectivesCache;
+static std::string DaemonSocket;
+static std::string ConnectSocket;
+static bool ShutdownDaemon;
+static unsigned DaemonIdleTimeout;
 static llvm::BumpPtrAllocator Alloc;
 static llvm::StringSaver Saver{Alloc};
 static std::vector<const char *> CommandLine;
@@ -230,6 +239,26 @@ static void ParseArgs(int argc, char **argv) {
     ResourceDirRecipe = *Kind;
   }
 
+  if (const llvm::opt::Arg *A = Args.getLastArg(OPT_directives_cache_EQ))
+    DirectivesCache = A->getValue();
+
+  if (const llvm::opt::Arg *A = Args.getLastArg(OPT_daemon_EQ))
+    DaemonSocket = A->getValue();
+
+  if (const llvm::opt::Arg *A = Args.getLastArg(OPT_connect_EQ))
+    ConnectSocket = A->getValue();
+
+  ShutdownDaemon = Args.hasArg(OPT_shutdown_daemon);
+
+  if (const llvm::opt::Arg *A = Args.getLastArg(OPT_daemon_idle_timeout_EQ)) {
+    StringRef S{A->getValue()};
+    if (!llvm::to_integer(S, DaemonIdleTimeout, 0)) {
+      llvm::errs() << ToolName << ": for the -daemon-idle-timeout option: '"
+                   << S << "' value invalid for uint argument!\n";
+      std::exit(1);
+    }
+  }
+
   PrintTiming = Args.hasArg(OPT_print_timing);
 
   Verbose = Args.hasArg(OPT_verbose);
@@ -764,12 +793,461 @@ static std::string getModuleCachePath(ArrayRef<std::string> Args) {
   return std::string(Path);
 }
 
+/// Serves scans of the inputs on a Unix domain socket. The dependencies of
+/// each translation unit are kept between requests and the directories of the
+/// files they depend on are watched, so that a request only rescans the
+/// translation units whose files changed since the previous one.
+///
+/// A connection carries a single request, a JSON object on one line: either
+/// {"command": "scan"} or {"command": "shutdown"}. A scan is answered with the
+/// experimental-full output for all inputs, or with an object holding an
+/// "error" string if any of them failed to scan, and the connection is closed.
+///
+/// Watcher events arrive asynchronously, and editing the target of a symlink
+/// is not reported for the directory of the symlink. So each request also
+/// compares the status of every file, following symlinks, with its status
+/// after the previous scan.
+///
+/// A file created in a directory that none of the dependencies of a
+/// translation unit live in is not noticed, even if it would now be found by
+/// one of its include lookups. A file modified while it is being scanned is
+/// only noticed if its directory was already watched.
+class ScanDaemon {
+public:
+  ScanDaemon(std::vector<tooling::CompileCommand> Inputs)
+      : Inputs(std::move(Inputs)), Results(this->Inputs.size()) {}
+
+  int run(StringRef SocketPath);
+
+private:
+  /// A file that a translation unit or one of its modules depends on.
+  struct FileDep {
+    /// The absolute path.
+    std::string Path;
+    /// The status after the scan, or std::nullopt if the file did not exist.
+    std::optional<llvm::sys::fs::file_status> Status;
+  };
+
+  struct TUResult {
+    std::optional<TranslationUnitDeps> Deps;
+    std::string Error;
+    std::vector<FileDep> Files;
+    /// Whether the translation unit needs to be (re)scanned. Failed scans
+    /// stay stale so that they are retried by the next request.
+    bool Stale = true;
+  };
+
+  void handleEvents(StringRef Dir, ArrayRef<DirectoryWatcher::Event> Events,
+                    bool IsInitial);
+  void markStale(StringRef Dir);
+  void markChangedStale();
+  void unwatch(ArrayRef<std::string> Dirs);
+  void applyChanges();
+  void scan(DependencyScanningTool &WorkerTool, size_t Index);
+  void rescan();
+  void watch();
+  void respond(raw_ostream &OS);
+
+  std::vector<tooling::CompileCommand> Inputs;
+  std::vector<TUResult> Results;
+  std::unique_ptr<DependencyScanningService> Service;
+
+  /// The translation units that depend on each file and on a file in each
+  /// directory.
+  llvm::StringMap<std::vector<size_t>> FileUsers;
+  llvm::StringMap<std::vector<size_t>> DirUsers;
+  llvm::StringMap<std::unique_ptr<DirectoryWatcher>> Watchers;
+
+  /// Filled in by the watcher threads.
+  std::mutex EventsLock;
+  llvm::StringSet<> ChangedFiles;
+  llvm::StringSet<> InvalidatedDirs;
+};
+
+void ScanDaemon::handleEvents(StringRef Dir,
+                              ArrayRef<DirectoryWatcher::Event> Events,
+                              bool IsInitial) {
+  // The initial events list the files that already exist.
+  if (IsInitial)
+    return;
+  std::lock_guard<std::mutex> LockGuard(EventsLock);
+  for (const DirectoryWatcher::Event &E : Events) {
+    using EventKind = DirectoryWatcher::Event::EventKind;
+    if (E.Kind == EventKind::WatchedDirRemoved ||
+        E.Kind == EventKind::WatcherGotInvalidated || E.Filename.empty()) {
+      InvalidatedDirs.insert(Dir);
+      continue;
+    }
+    SmallString<256> Path(Dir);
+    llvm::sys::path::append(Path, E.Filename);
+    ChangedFiles.insert(Path);
+  }
+}
+
+void ScanDaemon::markStale(StringRef Dir) {
+  auto It = DirUsers.find(Dir);
+  if (It != DirUsers.end())
+    for (size_t Index : It->second)
+      Results[Index].Stale = true;
+}
+
+/// Returns the status of \p Path, following symlinks, or std::nullopt if it
+/// does not exist.
+static std::optional<llvm::sys::fs::file_status> statFile(StringRef Path) {
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(Path, Status))
+    return std::nullopt;
+  return Status;
+}
+
+static bool isSameStatus(const std::optional<llvm::sys::fs::file_status> &A,
+                         const std::optional<llvm::sys::fs::file_status> &B) {
+  if (!A || !B)
+    return !A && !B;
+  return A->getUniqueID() == B->getUniqueID() && A->getSize() == B->getSize() &&
+         A->getLastModificationTime() == B->getLastModificationTime();
+}
+
+void ScanDaemon::markChangedStale() {
+  llvm::StringMap<std::optional<llvm::sys::fs::file_status>> Current;
+  for (TUResult &R : Results) {
+    if (R.Stale)
+      continue;
+    for (const FileDep &File : R.Files) {
+      auto [It, Inserted] = Current.try_emplace(File.Path);
+      if (Inserted)
+        It->second = statFile(File.Path);
+      if (!isSameStatus(It->second, File.Status)) {
+        R.Stale = true;
+        break;
+      }
+    }
+  }
+}
+
+void ScanDaemon::unwatch(ArrayRef<std::string> Dirs) {
+  for (const std::string &Dir : Dirs)
+    Watchers.erase(Dir);
+  // Destroying a watcher reports it as invalidated, which is not a change.
+  std::lock_guard<std::mutex> LockGuard(EventsLock);
+  for (const std::string &Dir : Dirs)
+    InvalidatedDirs.erase(Dir);
+}
+
+void ScanDaemon::applyChanges() {
+  std::vector<std::string> Changed, Invalidated;
+  {
+    std::lock_guard<std::mutex> LockGuard(EventsLock);
+    for (const auto &Entry : ChangedFiles)
+      Changed.push_back(Entry.getKey().str());
+    for (const auto &Entry : InvalidatedDirs)
+      Invalidated.push_back(Entry.getKey().str());
+    ChangedFiles.clear();
+  }
+
+  for (const std::string &File : Changed) {
+    auto It = FileUsers.find(File);
+    if (It != FileUsers.end()) {
+      for (size_t Index : It->second)
+        Results[Index].Stale = true;
+      continue;
+    }
+    // A new file may be found by an include lookup that used to find a file
+    // further down the search path.
+    markStale(llvm::sys::path::parent_path(File));
+  }
+
+  // Changes in a directory that is not watched are not reported, so the
+  // translation units that depend on it are always rescanned.
+  unwatch(Invalidated);
+  for (const auto &Entry : DirUsers)
+    if (!Watchers.count(Entry.getKey()))
+      markStale(Entry.getKey());
+
+  markChangedStale();
+}
+
+void ScanDaemon::scan(DependencyScanningTool &WorkerTool, size_t Index) {
+  const tooling::CompileCommand &Input = Inputs[Index];
+  std::string OutputDir(ModuleFilesDir);
+  if (OutputDir.empty())
+    OutputDir = getModuleCachePath(Input.CommandLine);
+  auto LookupOutput = [&](const ModuleDeps &MD, ModuleOutputKind MOK) {
+    return ::lookupModuleOutput(MD, MOK, OutputDir);
+  };
+
+  // The results are kept per translation unit, so each of them needs its full
+  // module graph.
+  llvm::DenseSet<ModuleID> AlreadySeenModules;
+  auto MaybeTUDeps = WorkerTool.getTranslationUnitDependencies(
+      Input.CommandLine, Input.Directory, AlreadySeenModules, LookupOutput);
+
+  TUResult &R = Results[Index];
+  R = TUResult();
+  if (!MaybeTUDeps) {
+    R.Error = llvm::toString(MaybeTUDeps.takeError());
+    return;
+  }
+
+  auto AddFile = [&](StringRef File) {
+    SmallString<256> Path(File);
+    llvm::sys::fs::make_absolute(Input.Directory, Path);
+    llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+    R.Files.push_back({std::string(Path), statFile(Path)});
+  };
+  AddFile(Input.Filename);
+  for (const std::string &File : MaybeTUDeps->FileDeps)
+    AddFile(File);
+  for (const ModuleDeps &MD : MaybeTUDeps->ModuleGraph)
+    MD.forEachFileDep(AddFile);
+  R.Deps = std::move(*MaybeTUDeps);
+  R.Stale = false;
+}
+
+void ScanDaemon::rescan() {
+  std::vector<size_t> Stale;
+  for (size_t I = 0, E = Results.size(); I != E; ++I)
+    if (Results[I].Stale)
+      Stale.push_back(I);
+  if (Stale.empty())
+    return;
+  if (Verbose)
+    for (size_t Index : Stale)
+      llvm::errs() << "Scanning " << Inputs[Index].Filename << "\n";
+
+  // The shared cache of a service is never invalidated, so the stale files
+  // are only read again by a new service. The dependency directives of the
+  // files that did not change can still be carried over with
+  // -directives-cache.
+  auto NewService = std::make_unique<DependencyScanningService>(
+      ScanMode, Format, OptimizeArgs, EagerLoadModules);
+  if (!DirectivesCache.empty()) {
+    if (Service)
+      if (llvm::Error E =
+              Service->getSharedCache().saveDependencyDirectives(
+                  DirectivesCache))
+        llvm::errs() << "Failed to save dependency directives to '"
+                     << DirectivesCache << "': "
+                     << llvm::toString(std::move(E)) << "\n";
+    NewService->getSharedCache().loadDependencyDirectives(DirectivesCache);
+  }
+  Service = std::move(NewService);
+
+  std::atomic<size_t> Next = 0;
+  auto ScanningTask = [&] {
+    DependencyScanningTool WorkerTool(*Service);
+    for (size_t I = Next++; I < Stale.size(); I = Next++)
+      scan(WorkerTool, Stale[I]);
+  };
+
+  if (Stale.size() == 1) {
+    ScanningTask();
+    return;
+  }
+  llvm::DefaultThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  for (unsigned I = 0; I < Pool.getMaxConcurrency(); ++I)
+    Pool.async(ScanningTask);
+  Pool.wait();
+}
+
+void ScanDaemon::watch() {
+  FileUsers.clear();
+  DirUsers.clear();
+  for (size_t I = 0, E = Results.size(); I != E; ++I) {
+    for (const FileDep &File : Results[I].Files) {
+      std::vector<size_t> &Users = FileUsers[File.Path];
+      if (Users.empty() || Users.back() != I)
+        Users.push_back(I);
+      std::vector<size_t> &DUsers =
+          DirUsers[llvm::sys::path::parent_path(File.Path)];
+      if (DUsers.empty() || DUsers.back() != I)
+        DUsers.push_back(I);
+    }
+  }
+
+  std::vector<std::string> Unused;
+  for (const auto &Entry : Watchers)
+    if (!DirUsers.count(Entry.getKey()))
+      Unused.push_back(Entry.getKey().str());
+  unwatch(Unused);
+
+  for (const auto &Entry : DirUsers) {
+    StringRef Dir = Entry.getKey();
+    if (Watchers.count(Dir) || !llvm::sys::fs::is_directory(Dir))
+      continue;
+    auto MaybeWatcher = DirectoryWatcher::create(
+        Dir,
+        [this, Dir = Dir.str()](ArrayRef<DirectoryWatcher::Event> Events,
+                                bool IsInitial) {
+          handleEvents(Dir, Events, IsInitial);
+        },
+        /*WaitForInitialSync=*/true);
+    if (!MaybeWatcher) {
+      if (Verbose)
+        llvm::errs() << "Failed to watch '" << Dir
+                     << "': " << llvm::toString(MaybeWatcher.takeError())
+                     << "\n";
+      else
+        llvm::consumeError(MaybeWatcher.takeError());
+      continue;
+    }
+    Watchers[Dir] = std::move(*MaybeWatcher);
+  }
+}
+
+void ScanDaemon::respond(raw_ostream &OS) {
+  std::string Errors;
+  for (size_t I = 0, E = Results.size(); I != E; ++I)
+    if (!Results[I].Deps)
+      Errors += "Error while scanning dependencies for " + Inputs[I].Filename +
+                ":\n" + Results[I].Error;
+  if (!Errors.empty()) {
+    llvm::json::OStream JOS(OS);
+    JOS.object([&] { JOS.attribute("error", Errors); });
+    OS << "\n";
+    return;
+  }
+
+  FullDeps FD(Inputs.size());
+  for (size_t I = 0, E = Results.size(); I != E; ++I)
+    FD.mergeDeps(Inputs[I].Filename, *Results[I].Deps, I);
+  FD.printFullOutput(OS);
+}
+
+int ScanDaemon::run(StringRef SocketPath) {
+  auto MaybeSocket = llvm::ListeningSocket::createUnix(SocketPath);
+  if (!MaybeSocket) {
+    llvm::errs() << "Failed to listen on '" << SocketPath
+                 << "': " << llvm::toString(MaybeSocket.takeError()) << "\n";
+    return 1;
+  }
+
+  // Scan everything up front so that the first request is answered quickly.
+  rescan();
+  watch();
+  if (Verbose)
+    llvm::errs() << "Scanned " << Inputs.size() << " files, listening on '"
+                 << SocketPath << "'\n";
+
+  // A negative timeout waits for the next request forever.
+  std::chrono::milliseconds IdleTimeout(-1);
+  if (DaemonIdleTimeout)
+    IdleTimeout = std::chrono::seconds(DaemonIdleTimeout);
+
+  for (;;) {
+    auto MaybeClient = MaybeSocket->accept(IdleTimeout);
+    if (!MaybeClient) {
+      std::error_code EC = llvm::errorToErrorCode(MaybeClient.takeError());
+      if (EC == std::errc::timed_out) {
+        if (Verbose)
+          llvm::errs() << "No request in " << DaemonIdleTimeout
+                       << " seconds, shutting down\n";
+        return 0;
+      }
+      llvm::errs() << "Failed to accept a connection: " << EC.message()
+                   << "\n";
+      return 1;
+    }
+    llvm::raw_socket_stream &Client = **MaybeClient;
+
+    std::string Request;
+    char Buffer[256];
+    while (!StringRef(Request).contains('\n')) {
+      ssize_t N = Client.read(Buffer, sizeof(Buffer));
+      if (N <= 0)
+        break;
+      Request.append(Buffer, N);
+    }
+
+    std::optional<StringRef> Command;
+    llvm::Expected<llvm::json::Value> MaybeRequest =
+        llvm::json::parse(StringRef(Request).split('\n').first);
+    if (!MaybeRequest)
+      llvm::consumeError(MaybeRequest.takeError());
+    else if (const llvm::json::Object *O = MaybeRequest->getAsObject())
+      Command = O->getString("command");
+
+    if (Command == "shutdown")
+      return 0;
+    if (Command == "scan") {
+      applyChanges();
+      rescan();
+      watch();
+      respond(Client);
+    } else {
+      llvm::json::OStream JOS(Client);
+      JOS.object([&] { JOS.attribute("error", "invalid request"); });
+      Client << "\n";
+    }
+    Client.flush();
+  }
+}
+
+/// Sends a request to the daemon listening on \p SocketPath and writes the
+/// response to the output file.
+static int runClient(StringRef SocketPath) {
+  auto MaybeServer = llvm::raw_socket_stream::createConnectedUnix(SocketPath);
+  if (!MaybeServer) {
+    llvm::errs() << "Failed to connect to '" << SocketPath
+                 << "': " << llvm::toString(MaybeServer.takeError()) << "\n";
+    return 1;
+  }
+  llvm::raw_socket_stream &Server = **MaybeServer;
+  {
+    llvm::json::OStream JOS(Server);
+    JOS.object([&] {
+      JOS.attribute("command", ShutdownDaemon ? "shutdown" : "scan");
+    });
+  }
+  Server << "\n";
+  Server.flush();
+
+  std::string Response;
+  char Buffer[4096];
+  for (;;) {
+    ssize_t N = Server.read(Buffer, sizeof(Buffer));
+    if (N <= 0)
+      break;
+    Response.append(Buffer, N);
+  }
+  if (ShutdownDaemon)
+    return 0;
+
+  if (StringRef(Response).starts_with("{\"error\":")) {
+    llvm::Expected<llvm::json::Value> MaybeError = llvm::json::parse(Response);
+    if (!MaybeError) {
+      llvm::consumeError(MaybeError.takeError());
+    } else if (const llvm::json::Object *O = MaybeError->getAsObject()) {
+      if (std::optional<StringRef> Error = O->getString("error")) {
+        llvm::errs() << *Error;
+        return 1;
+      }
+    }
+  }
+  if (Response.empty()) {
+    llvm::errs() << "No response from '" << SocketPath << "'\n";
+    return 1;
+  }
+
+  if (OutputFileName == "-") {
+    llvm::outs() << Response;
+    return 0;
+  }
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(OutputFileName, EC, llvm::sys::fs::OF_Text);
+  if (EC) {
+    llvm::errs() << "Failed to open output file '" << OutputFileName
+                 << "': " << EC.message() << '\n';
+    return 1;
+  }
+  OS << Response;
+  return 0;
+}
+
 /// Attempts to construct the compilation database from '-compilation-database'
 /// or from the arguments following the positional '--'.
 static std::unique_ptr<tooling::CompilationDatabase>
-getCompilationDatabase(int argc, char **argv, std::string &ErrorMessage) {
-  ParseArgs(argc, argv);
-
+getCompilationDatabase(std::string &ErrorMessage) {
   if (!(CommandLine.empty() ^ CompilationDB.empty())) {
     llvm::errs() << "The compilation command line must be provided either via "
                     "'-compilation-database' or after '--'.";
@@ -853,9 +1331,13 @@ getCompilationDatabase(int argc, char **argv, std::string &ErrorMessage) {
 
 int clang_scan_deps_main(int argc, char **argv, const llvm::ToolContext &) {
   llvm::InitializeAllTargetInfos();
+  ParseArgs(argc, argv);
+  if (!ConnectSocket.empty())
+    return runClient(ConnectSocket);
+
   std::string ErrorMessage;
   std::unique_ptr<tooling::CompilationDatabase> Compilations =
-      getCompilationDatabase(argc, argv, ErrorMessage);
+      getCompilationDatabase(ErrorMessage);
   if (!Compilations) {
     llvm::errs() << ErrorMessage << "\n";
     return 1;
@@ -942,6 +1424,18 @@ int clang_scan_deps_main(int argc, char **argv, const llvm::ToolContext &) {
         return AdjustedArgs;
       });
 
+  if (!DaemonSocket.empty()) {
+    if (Format != ScanningOutputFormat::Full || ModuleName ||
+        !TranslationUnitFile.empty()) {
+      llvm::errs() << "'-daemon' requires '-format=experimental-full' and is "
+                      "not compatible with '-module-name' or "
+                      "'-tu-buffer-path'\n";
+      return 1;
+    }
+    return ScanDaemon(AdjustingCompilations->getAllCompileCommands())
+        .run(DaemonSocket);
+  }
+
   SharedStream Errs(llvm::errs());
 
   std::optional<llvm::raw_fd_ostream> FileOS;
@@ -1100,6 +1594,8 @@ int clang_scan_deps_main(int argc, char **argv, const llvm::ToolContext &) {
 
   DependencyScanningService Service(ScanMode, Format, OptimizeArgs,
                                     EagerLoadModules, /*TraceVFS=*/Verbose);
+  if (!DirectivesCache.empty())
+    Service.getSharedCache().loadDependencyDirectives(DirectivesCache);
 
   llvm::Timer T;
   T.startTimer();
@@ -1123,6 +1619,13 @@ int clang_scan_deps_main(int argc, char **argv, const llvm::ToolContext &) {
 
   T.stopTimer();
 
+  if (!DirectivesCache.empty())
+    if (llvm::Error E =
+            Service.getSharedCache().saveDependencyDirectives(DirectivesCache))
+      llvm::errs() << "Failed to save dependency directives to '"
+                   << DirectivesCache << "': " << llvm::toString(std::move(E))
+                   << "\n";
+
   if (Verbose)
     llvm::errs() << "\n*** Virtual File System Stats:\n"
                  << NumStatusCalls << " status() calls\n"
@@ -8,6 +8,8 @@
 
 #include "clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "gtest/gtest.h"
 
@@ -233,3 +235,88 @@ TEST(DependencyScanningFilesystem, DiagnoseCachedFileSizeChange) {
   ASSERT_EQ(SizeInfo->CachedSize, 0u);
   ASSERT_EQ(SizeInfo->ActualSize, 8u);
 }
+
+TEST(DependencyScanningFilesystem, SaveAndLoadDependencyDirectives) {
+  auto InMemoryFS = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  InMemoryFS->setCurrentWorkingDirectory("/");
+  InMemoryFS->addFile("/foo.h", 1,
+                      llvm::MemoryBuffer::getMemBuffer("#include \"bar.h\"\n"
+                                                       "#define FOO 1\n"));
+
+  llvm::SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("directives", "bin", Path));
+  llvm::FileRemover Cleanup(Path);
+
+  {
+    DependencyScanningFilesystemSharedCache SharedCache;
+    DependencyScanningWorkerFilesystem DepFS(SharedCache, InMemoryFS);
+    ASSERT_TRUE(DepFS.getDirectiveTokens("/foo.h"));
+    ASSERT_FALSE(llvm::errorToBool(SharedCache.saveDependencyDirectives(Path)));
+  }
+
+  DependencyScanningFilesystemSharedCache SharedCache;
+  SharedCache.loadDependencyDirectives(Path);
+  llvm::ErrorOr<llvm::vfs::Status> Stat = InMemoryFS->status("/foo.h");
+  ASSERT_TRUE(Stat);
+
+  llvm::SmallVector<clang::dependency_directives_scan::Token> Tokens;
+  llvm::SmallVector<clang::dependency_directives_scan::Directive> Directives;
+  ASSERT_TRUE(
+      SharedCache.getSavedDependencyDirectives(*Stat, Tokens, Directives));
+  ASSERT_EQ(Directives.size(), 3u);
+  EXPECT_EQ(Directives[0].Kind, clang::dependency_directives_scan::pp_include);
+  EXPECT_EQ(Directives[1].Kind, clang::dependency_directives_scan::pp_define);
+  EXPECT_EQ(Directives[2].Kind, clang::dependency_directives_scan::pp_eof);
+  EXPECT_EQ(Directives[1].Tokens.front().Offset, 17u);
+
+  // The saved directives are not used once the file is modified.
+  llvm::vfs::Status Modified(Stat->getName(), Stat->getUniqueID(),
+                             llvm::sys::toTimePoint(2), Stat->getUser(),
+                             Stat->getGroup(), Stat->getSize(), Stat->getType(),
+                             Stat->getPermissions());
+  EXPECT_FALSE(
+      SharedCache.getSavedDependencyDirectives(Modified, Tokens, Directives));
+
+  // Scanning the file through a worker filesystem uses the saved directives.
+  DependencyScanningWorkerFilesystem DepFS(SharedCache, InMemoryFS);
+  auto Loaded = DepFS.getDirectiveTokens("/foo.h");
+  ASSERT_TRUE(Loaded);
+  EXPECT_EQ(Loaded->size(), 3u);
+}
+
+TEST(DependencyScanningFilesystem, DropUnusedDependencyDirectives) {
+  auto InMemoryFS = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  InMemoryFS->setCurrentWorkingDirectory("/");
+  InMemoryFS->addFile("/foo.h", 1,
+                      llvm::MemoryBuffer::getMemBuffer("#define FOO 1\n"));
+  llvm::ErrorOr<llvm::vfs::Status> Stat = InMemoryFS->status("/foo.h");
+  ASSERT_TRUE(Stat);
+
+  llvm::SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("directives", "bin", Path));
+  llvm::FileRemover Cleanup(Path);
+
+  {
+    DependencyScanningFilesystemSharedCache SharedCache;
+    DependencyScanningWorkerFilesystem DepFS(SharedCache, InMemoryFS);
+    ASSERT_TRUE(DepFS.getDirectiveTokens("/foo.h"));
+    ASSERT_FALSE(llvm::errorToBool(SharedCache.saveDependencyDirectives(Path)));
+  }
+
+  // Processes that do not see the file again keep its entry, but only for
+  // eight saves.
+  llvm::SmallVector<clang::dependency_directives_scan::Token> Tokens;
+  llvm::SmallVector<clang::dependency_directives_scan::Directive> Directives;
+  for (unsigned I = 0; I != 8; ++I) {
+    DependencyScanningFilesystemSharedCache SharedCache;
+    SharedCache.loadDependencyDirectives(Path);
+    ASSERT_TRUE(
+        SharedCache.getSavedDependencyDirectives(*Stat, Tokens, Directives));
+    ASSERT_FALSE(llvm::errorToBool(SharedCache.saveDependencyDirectives(Path)));
+  }
+
+  DependencyScanningFilesystemSharedCache SharedCache;
+  SharedCache.loadDependencyDirectives(Path);
+  EXPECT_FALSE(
+      SharedCache.getSavedDependencyDirectives(*Stat, Tokens, Directives));
+}
@@ -192,6 +192,13 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
       },
       cache));
 
+  if (const FileCacheStats *stats = cache.getStats()) {
+    std::string s;
+    raw_string_ostream os(s);
+    stats->print(os);
+    Log(ctx) << "/lldltocache: " << s;
+  }
+
   // Emit empty index files for non-indexed files
   for (StringRef s : thinIndices) {
     std::string path = getThinLTOOutputFile(s);
@@ -45,6 +45,7 @@
 #include "llvm/Support/CRC.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "llvm/Support/TimeProfiler.h"
@@ -62,6 +63,29 @@ using llvm::pdb::StringTableFixup;
 namespace {
 class DebugSHandler;
 
+/// Warnings and log messages found while processing the symbol records of an
+/// object file. The records of different files are processed in parallel, so
+/// the messages are collected here and reported later in file order.
+class DeferredDiagnostics {
+public:
+  void warn(const Twine &msg) { diags.push_back({true, msg.str()}); }
+  void log(const Twine &msg) { diags.push_back({false, msg.str()}); }
+
+  /// Report the collected messages in the order in which they were found.
+  void report(COFFLinkerContext &ctx) {
+    for (auto &[isWarning, msg] : diags) {
+      if (isWarning)
+        Warn(ctx) << msg;
+      else
+        Log(ctx) << msg;
+    }
+    diags.clear();
+  }
+
+private:
+  std::vector<std::pair<bool, std::string>> diags;
+};
+
 class PDBLinker {
   friend DebugSHandler;
 
@@ -94,21 +118,10 @@ public:
 
   void createModuleDBI(ObjFile *file);
 
-  /// Link CodeView from a single object file into the target (output) PDB.
+  /// Link CodeView from the given object files into the target (output) PDB.
   /// When a precompiled headers object is linked, its TPI map might be provided
   /// externally.
-  void addDebug(TpiSource *source);
-
-  void addDebugSymbols(TpiSource *source);
-
-  // Analyze the symbol records to separate module symbols from global symbols,
-  // find string references, and calculate how large the symbol stream will be
-  // in the PDB.
-  void analyzeSymbolSubsection(SectionChunk *debugChunk,
-                               uint32_t &moduleSymOffset,
-                               uint32_t &nextRelocIndex,
-                               std::vector<StringTableFixup> &stringTableFixups,
-                               BinaryStreamRef symData);
+  void addDebug(ArrayRef<TpiSource *> sources);
 
   // Write all module symbols from all live debug symbol subsections of the
   // given object file into the given stream writer.
@@ -124,7 +137,8 @@ public:
   void writeSymbolRecord(SectionChunk *debugChunk,
                          ArrayRef<uint8_t> sectionContents, CVSymbol sym,
                          size_t alignedSize, uint32_t &nextRelocIndex,
-                         std::vector<uint8_t> &storage);
+                         std::vector<uint8_t> &storage,
+                         DeferredDiagnostics &diags);
 
   /// Add the section map and section contributions to the PDB.
   void addSections(ArrayRef<uint8_t> sectionTable);
@@ -138,7 +152,7 @@ public:
 private:
   void pdbMakeAbsolute(SmallVectorImpl<char> &fileName);
   void translateIdSymbols(MutableArrayRef<uint8_t> &recordData,
-                          TpiSource *source);
+                          TpiSource *source, DeferredDiagnostics &diags);
   void addCommonLinkerModuleSymbols(StringRef path,
                                     pdb::DbiModuleDescriptorBuilder &mod);
 
@@ -211,8 +225,34 @@ class DebugSHandler {
   /// handleDebugS call.
   uint32_t nextRelocIndex = 0;
 
+  /// The live .debug$F sections. Relocating them allocates from the shared
+  /// allocator, so they are handled in finish().
+  std::vector<SectionChunk *> debugFChunks;
+
+  /// Relocated and remapped global symbol records, and the module stream
+  /// offset of each of them. Global symbols are deduplicated by the GSI
+  /// builder, so they are added in finish() in file order rather than by
+  /// the parallel analysis.
+  std::vector<uint8_t> globalSymbolStorage;
+  std::vector<std::pair<uint32_t, uint32_t>> globalSymbolOffsets;
+
+  /// Number of symbol records that go in the module stream.
+  uint64_t numModuleSymbols = 0;
+
+  /// Warnings and log messages found by analyze(), reported by finish().
+  DeferredDiagnostics diags;
+
+  /// The error that stopped analyze(), reported by finish().
+  Error analyzeError = Error::success();
+
   void advanceRelocIndex(SectionChunk *debugChunk, ArrayRef<uint8_t> subsec);
 
+  // Analyze the symbol records to separate module symbols from global symbols,
+  // find string references, and calculate how large the symbol stream will be
+  // in the PDB.
+  void analyzeSymbolSubsection(SectionChunk *debugChunk,
+                               BinaryStreamRef symData);
+
   void addUnrelocatedSubsection(SectionChunk *debugChunk,
                                 const DebugSubsectionRecord &ss);
 
@@ -223,8 +263,15 @@ public:
   DebugSHandler(COFFLinkerContext &ctx, PDBLinker &linker, ObjFile &file)
       : ctx(ctx), linker(linker), file(file) {}
 
-  void handleDebugS(SectionChunk *debugChunk);
+  /// Process all live .debug$S sections of the file. This only modifies
+  /// state owned by the file and reports no diagnostics, so it can run in
+  /// parallel for different files.
+  void analyze();
+
+  Error handleDebugS(SectionChunk *debugChunk);
 
+  /// Report the diagnostics found by analyze(), then add its results to the
+  /// PDB-wide streams and string table.
   void finish();
 };
 }
@@ -300,7 +347,8 @@ static void addGHashTypeInfo(COFFLinkerContext &ctx,
 
 static void
 recordStringTableReferences(CVSymbol sym, uint32_t symOffset,
-                            std::vector<StringTableFixup> &stringTableFixups) {
+                            std::vector<StringTableFixup> &stringTableFixups,
+                            DeferredDiagnostics &diags) {
   // For now we only handle S_FILESTATIC, but we may need the same logic for
   // S_DEFRANGE and S_DEFRANGE_SUBFIELD.  However, I cannot seem to generate any
   // PDBs that contain these types of records, so because of the uncertainty
@@ -314,8 +362,8 @@ recordStringTableReferences(CVSymbol sym, uint32_t symOffset,
   }
   case SymbolKind::S_DEFRANGE:
   case SymbolKind::S_DEFRANGE_SUBFIELD:
-    log("Not fixing up string table reference in S_DEFRANGE / "
-        "S_DEFRANGE_SUBFIELD record");
+    diags.log("Not fixing up string table reference in S_DEFRANGE / "
+              "S_DEFRANGE_SUBFIELD record");
     break;
   default:
     break;
@@ -330,7 +378,8 @@ static SymbolKind symbolKind(ArrayRef<uint8_t> recordData) {
 
 /// MSVC translates S_PROC_ID_END to S_END, and S_[LG]PROC32_ID to S_[LG]PROC32
 void PDBLinker::translateIdSymbols(MutableArrayRef<uint8_t> &recordData,
-                                   TpiSource *source) {
+                                   TpiSource *source,
+                                   DeferredDiagnostics &diags) {
   RecordPrefix *prefix = reinterpret_cast<RecordPrefix *>(recordData.data());
 
   SymbolKind kind = symbolKind(recordData);
@@ -375,11 +424,11 @@ void PDBLinker::translateIdSymbols(MutableArrayRef<uint8_t> &recordData,
         }
       }
       if (newType == TypeIndex(SimpleTypeKind::NotTranslated)) {
-        Warn(ctx) << formatv(
+        diags.warn(formatv(
             "procedure symbol record for `{0}` in {1} refers to PDB "
             "item index {2:X} which is not a valid function ID record",
             getSymbolName(CVSymbol(recordData)), source->file->getName(),
-            ti->getIndex());
+            ti->getIndex()));
       }
       *ti = newType;
     }
@@ -411,15 +460,13 @@ static void scopeStackOpen(SmallVectorImpl<uint32_t> &stack,
   stack.push_back(storage.size());
 }
 
-// To close a scope, update the record that opened the scope.
-static void scopeStackClose(COFFLinkerContext &ctx,
-                            SmallVectorImpl<uint32_t> &stack,
+// To close a scope, update the record that opened the scope. Unbalanced
+// scopes have already been reported by DebugSHandler::analyze().
+static void scopeStackClose(SmallVectorImpl<uint32_t> &stack,
                             std::vector<uint8_t> &storage,
-                            uint32_t storageBaseOffset, ObjFile *file) {
-  if (stack.empty()) {
-    Warn(ctx) << "symbol scopes are not balanced in " << file->getName();
+                            uint32_t storageBaseOffset) {
+  if (stack.empty())
     return;
-  }
 
   // Update ptrEnd of the record that opened the scope to point to the
   // current record, if we are writing into the module symbol stream.
@@ -482,9 +529,8 @@ static bool symbolGoesInGlobalsStream(const CVSymbol &sym,
 }
 
 static void addGlobalSymbol(pdb::GSIStreamBuilder &builder, uint16_t modIndex,
-                            unsigned symOffset,
-                            std::vector<uint8_t> &symStorage) {
-  CVSymbol sym{ArrayRef(symStorage)};
+                            unsigned symOffset, ArrayRef<uint8_t> symData) {
+  CVSymbol sym{symData};
   switch (sym.kind()) {
   case SymbolKind::S_CONSTANT:
   case SymbolKind::S_UDT:
@@ -549,7 +595,8 @@ void PDBLinker::writeSymbolRecord(SectionChunk *debugChunk,
                                   ArrayRef<uint8_t> sectionContents,
                                   CVSymbol sym, size_t alignedSize,
                                   uint32_t &nextRelocIndex,
-                                  std::vector<uint8_t> &storage) {
+                                  std::vector<uint8_t> &storage,
+                                  DeferredDiagnostics &diags) {
   // Allocate space for the new record at the end of the storage.
   storage.resize(storage.size() + alignedSize);
   auto recordBytes = MutableArrayRef<uint8_t>(storage).take_back(alignedSize);
@@ -562,40 +609,42 @@ void PDBLinker::writeSymbolRecord(SectionChunk *debugChunk,
   // Re-map all the type index references.
   TpiSource *source = debugChunk->file->debugTypesObj;
   if (!source->remapTypesInSymbolRecord(recordBytes)) {
-    Log(ctx) << "ignoring unknown symbol record with kind 0x"
-             << utohexstr(sym.kind());
+    diags.log("ignoring unknown symbol record with kind 0x" +
+              utohexstr(sym.kind()));
     replaceWithSkipRecord(recordBytes);
   }
 
   // An object file may have S_xxx_ID symbols, but these get converted to
   // "real" symbols in a PDB.
-  translateIdSymbols(recordBytes, source);
+  translateIdSymbols(recordBytes, source, diags);
 }
 
-void PDBLinker::analyzeSymbolSubsection(
-    SectionChunk *debugChunk, uint32_t &moduleSymOffset,
-    uint32_t &nextRelocIndex, std::vector<StringTableFixup> &stringTableFixups,
-    BinaryStreamRef symData) {
-  ObjFile *file = debugChunk->file;
+void DebugSHandler::analyzeSymbolSubsection(SectionChunk *debugChunk,
+                                            BinaryStreamRef symData) {
+  uint32_t &moduleSymOffset = moduleStreamSize;
   uint32_t moduleSymStart = moduleSymOffset;
 
   uint32_t scopeLevel = 0;
-  std::vector<uint8_t> storage;
   ArrayRef<uint8_t> sectionContents = debugChunk->getContents();
 
   ArrayRef<uint8_t> symsBuffer;
   cantFail(symData.readBytes(0, symData.getLength(), symsBuffer));
 
   if (symsBuffer.empty())
-    Warn(ctx) << "empty symbols subsection in " << file->getName();
+    diags.warn("empty symbols subsection in " + file.getName());
 
   Error ec = forEachCodeViewRecord<CVSymbol>(
       symsBuffer, [&](CVSymbol sym) -> llvm::Error {
-        // Track the current scope.
-        if (symbolOpensScope(sym.kind()))
+        // Track the current scope. Unbalanced scopes are reported here rather
+        // than when the module symbols are written.
+        if (symbolOpensScope(sym.kind())) {
           ++scopeLevel;
-        else if (symbolEndsScope(sym.kind()))
-          --scopeLevel;
+        } else if (symbolEndsScope(sym.kind())) {
+          if (scopeLevel == 0)
+            diags.warn("symbol scopes are not balanced in " + file.getName());
+          else
+            --scopeLevel;
+        }
 
         uint32_t alignedSize =
             alignTo(sym.length(), alignOf(CodeViewContainer::Pdb));
@@ -603,22 +652,21 @@ void PDBLinker::analyzeSymbolSubsection(
         // Copy global records. Some global records (mainly procedures)
         // reference the current offset into the module stream.
         if (symbolGoesInGlobalsStream(sym, scopeLevel)) {
-          storage.clear();
-          writeSymbolRecord(debugChunk, sectionContents, sym, alignedSize,
-                            nextRelocIndex, storage);
-          addGlobalSymbol(builder.getGsiBuilder(),
-                          file->moduleDBI->getModuleIndex(), moduleSymOffset,
-                          storage);
-          ++globalSymbols;
+          globalSymbolOffsets.emplace_back(globalSymbolStorage.size(),
+                                           moduleSymOffset);
+          linker.writeSymbolRecord(debugChunk, sectionContents, sym,
+                                   alignedSize, nextRelocIndex,
+                                   globalSymbolStorage, diags);
         }
 
         // Update the module stream offset and record any string table index
         // references. There are very few of these and they will be rewritten
         // later during PDB writing.
         if (symbolGoesInModuleStream(sym, scopeLevel)) {
-          recordStringTableReferences(sym, moduleSymOffset, stringTableFixups);
+          recordStringTableReferences(sym, moduleSymOffset, stringTableFixups,
+                                      diags);
           moduleSymOffset += alignedSize;
-          ++moduleSymbols;
+          ++numModuleSymbols;
         }
 
         return Error::success();
@@ -628,7 +676,7 @@ void PDBLinker::analyzeSymbolSubsection(
   // any partial records, undo that. For globals, we just keep what we have and
   // continue.
   if (ec) {
-    Warn(ctx) << "corrupt symbol records in " << file->getName();
+    diags.warn("corrupt symbol records in " + file.getName());
     moduleSymOffset = moduleSymStart;
     consumeError(std::move(ec));
   }
@@ -639,6 +687,7 @@ Error PDBLinker::writeAllModuleSymbolRecords(ObjFile *file,
   ExitOnError exitOnErr;
   std::vector<uint8_t> storage;
   SmallVector<uint32_t, 4> scopes;
+  DeferredDiagnostics diags;
 
   // Visit all live .debug$S sections a second time, and write them to the PDB.
   for (SectionChunk *debugChunk : file->getDebugChunks()) {
@@ -671,14 +720,14 @@ Error PDBLinker::writeAllModuleSymbolRecords(ObjFile *file,
             if (symbolOpensScope(sym.kind()))
               scopeStackOpen(scopes, storage);
             else if (symbolEndsScope(sym.kind()))
-              scopeStackClose(ctx, scopes, storage, moduleSymStart, file);
+              scopeStackClose(scopes, storage, moduleSymStart);
 
             // Copy, relocate, and rewrite each module symbol.
             if (symbolGoesInModuleStream(sym, scopes.size())) {
               uint32_t alignedSize =
                   alignTo(sym.length(), alignOf(CodeViewContainer::Pdb));
               writeSymbolRecord(debugChunk, sectionContents, sym, alignedSize,
-                                nextRelocIndex, storage);
+                                nextRelocIndex, storage, diags);
             }
             return Error::success();
           });
@@ -694,11 +743,14 @@ Error PDBLinker::writeAllModuleSymbolRecords(ObjFile *file,
       // at once.
       // TODO: Consider buffering symbols for the entire object file to reduce
       // overhead even further.
-      if (Error e = writer.writeBytes(storage))
+      if (Error e = writer.writeBytes(storage)) {
+        diags.report(ctx);
         return e;
+      }
     }
   }
 
+  diags.report(ctx);
   return Error::success();
 }
 
@@ -746,16 +798,40 @@ translateStringTableIndex(COFFLinkerContext &ctx, uint32_t objIndex,
   return pdbStrTable.insert(*expectedString);
 }
 
-void DebugSHandler::handleDebugS(SectionChunk *debugChunk) {
+// Allocate memory for a .debug$S / .debug$F section and relocate it.
+static ArrayRef<uint8_t> relocateDebugChunk(SectionChunk &debugChunk) {
+  uint8_t *buffer = bAlloc().Allocate<uint8_t>(debugChunk.getSize());
+  assert(debugChunk.getOutputSectionIdx() == 0 &&
+         "debug sections should not be in output sections");
+  debugChunk.writeTo(buffer);
+  return ArrayRef(buffer, debugChunk.getSize());
+}
+
+void DebugSHandler::analyze() {
+  for (SectionChunk *debugChunk : file.getDebugChunks()) {
+    if (!debugChunk->live || debugChunk->getSize() == 0)
+      continue;
+    StringRef name = debugChunk->getSectionName();
+    if (name == ".debug$S") {
+      if (Error e = handleDebugS(debugChunk)) {
+        analyzeError = std::move(e);
+        return;
+      }
+    } else if (name == ".debug$F") {
+      debugFChunks.push_back(debugChunk);
+    }
+  }
+}
+
+Error DebugSHandler::handleDebugS(SectionChunk *debugChunk) {
   // Note that we are processing the *unrelocated* section contents. They will
   // be relocated later during PDB writing.
   ArrayRef<uint8_t> contents = debugChunk->getContents();
   contents = SectionChunk::consumeDebugMagic(contents, ".debug$S");
   DebugSubsectionArray subsections;
   BinaryStreamReader reader(contents, llvm::endianness::little);
-  ExitOnError exitOnErr;
-  exitOnErr(reader.readArray(subsections, contents.size()));
-  debugChunk->sortRelocations();
+  if (Error e = reader.readArray(subsections, contents.size()))
+    return e;
 
   // Reset the relocation index, since this is a new section.
   nextRelocIndex = 0;
@@ -770,13 +846,15 @@ void DebugSHandler::handleDebugS(SectionChunk *debugChunk) {
     case DebugSubsectionKind::StringTable: {
       assert(!cvStrTab.valid() &&
              "Encountered multiple string table subsections!");
-      exitOnErr(cvStrTab.initialize(ss.getRecordData()));
+      if (Error e = cvStrTab.initialize(ss.getRecordData()))
+        return e;
       break;
     }
     case DebugSubsectionKind::FileChecksums:
       assert(!checksums.valid() &&
              "Encountered multiple checksum subsections!");
-      exitOnErr(checksums.initialize(ss.getRecordData()));
+      if (Error e = checksums.initialize(ss.getRecordData()))
+        return e;
       break;
     case DebugSubsectionKind::Lines:
     case DebugSubsectionKind::InlineeLines:
@@ -786,9 +864,7 @@ void DebugSHandler::handleDebugS(SectionChunk *debugChunk) {
       addFrameDataSubsection(debugChunk, ss);
       break;
     case DebugSubsectionKind::Symbols:
-      linker.analyzeSymbolSubsection(debugChunk, moduleStreamSize,
-                                     nextRelocIndex, stringTableFixups,
-                                     ss.getRecordData());
+      analyzeSymbolSubsection(debugChunk, ss.getRecordData());
       break;
 
     case DebugSubsectionKind::CrossScopeImports:
@@ -813,12 +889,13 @@ void DebugSHandler::handleDebugS(SectionChunk *debugChunk) {
       break;
 
     default:
-      Warn(ctx) << "ignoring unknown debug$S subsection kind 0x"
-                << utohexstr(uint32_t(ss.kind())) << " in file "
-                << toString(&file);
+      diags.warn("ignoring unknown debug$S subsection kind 0x" +
+                 utohexstr(uint32_t(ss.kind())) + " in file " +
+                 toString(&file));
       break;
     }
   }
+  return Error::success();
 }
 
 void DebugSHandler::advanceRelocIndex(SectionChunk *sc,
@@ -913,6 +990,36 @@ getFileName(const DebugStringTableSubsectionRef &strings,
 
 void DebugSHandler::finish() {
   pdb::DbiStreamBuilder &dbiBuilder = linker.builder.getDbiBuilder();
+  ExitOnError exitOnErr;
+
+  diags.report(ctx);
+  exitOnErr(std::move(analyzeError));
+
+  // Add the global symbols in the order in which they appear in the file.
+  uint16_t modIndex = file.moduleDBI->getModuleIndex();
+  for (auto [storageOffset, moduleSymOffset] : globalSymbolOffsets) {
+    ArrayRef<uint8_t> rec =
+        ArrayRef(globalSymbolStorage).drop_front(storageOffset);
+    auto *prefix = reinterpret_cast<const RecordPrefix *>(rec.data());
+    addGlobalSymbol(linker.builder.getGsiBuilder(), modIndex, moduleSymOffset,
+                    rec.take_front(prefix->RecordLen + 2));
+  }
+  linker.globalSymbols += globalSymbolOffsets.size();
+  linker.moduleSymbols += numModuleSymbols;
+
+  // Handle old FPO data .debug$F sections. These are relatively rare.
+  for (SectionChunk *debugChunk : debugFChunks) {
+    ArrayRef<uint8_t> relocatedDebugContents = relocateDebugChunk(*debugChunk);
+    FixedStreamArray<object::FpoData> fpoRecords;
+    BinaryStreamReader reader(relocatedDebugContents, llvm::endianness::little);
+    uint32_t count = relocatedDebugContents.size() / sizeof(object::FpoData);
+    exitOnErr(reader.readArray(fpoRecords, count));
+
+    // These are already relocated and don't refer to the string table, so we
+    // can just copy it.
+    for (const object::FpoData &fd : fpoRecords)
+      dbiBuilder.addOldFpoData(fd);
+  }
 
   // If we found any symbol records for the module symbol stream, defer them.
   if (moduleStreamSize > kSymbolStreamMagicSize)
@@ -934,8 +1041,6 @@ void DebugSHandler::finish() {
     return;
   }
 
-  ExitOnError exitOnErr;
-
   // Handle FPO data. Each subsection begins with a single image base
   // relocation, which is then added to the RvaStart of each frame data record
   // when it is added to the PDB. The string table indices for the FPO program
@@ -1008,59 +1113,6 @@ static void warnUnusable(InputFile *f, Error e, bool shouldWarn) {
     diag << "\n>>> failed to load reference " << std::move(e);
 }
 
-// Allocate memory for a .debug$S / .debug$F section and relocate it.
-static ArrayRef<uint8_t> relocateDebugChunk(SectionChunk &debugChunk) {
-  uint8_t *buffer = bAlloc().Allocate<uint8_t>(debugChunk.getSize());
-  assert(debugChunk.getOutputSectionIdx() == 0 &&
-         "debug sections should not be in output sections");
-  debugChunk.writeTo(buffer);
-  return ArrayRef(buffer, debugChunk.getSize());
-}
-
-void PDBLinker::addDebugSymbols(TpiSource *source) {
-  // If this TpiSource doesn't have an object file, it must be from a type
-  // server PDB. Type server PDBs do not contain symbols, so stop here.
-  if (!source->file)
-    return;
-
-  llvm::TimeTraceScope timeScope("Merge symbols");
-  ScopedTimer t(ctx.symbolMergingTimer);
-  ExitOnError exitOnErr;
-  pdb::DbiStreamBuilder &dbiBuilder = builder.getDbiBuilder();
-  DebugSHandler dsh(ctx, *this, *source->file);
-  // Now do all live .debug$S and .debug$F sections.
-  for (SectionChunk *debugChunk : source->file->getDebugChunks()) {
-    if (!debugChunk->live || debugChunk->getSize() == 0)
-      continue;
-
-    bool isDebugS = debugChunk->getSectionName() == ".debug$S";
-    bool isDebugF = debugChunk->getSectionName() == ".debug$F";
-    if (!isDebugS && !isDebugF)
-      continue;
-
-    if (isDebugS) {
-      dsh.handleDebugS(debugChunk);
-    } else if (isDebugF) {
-      // Handle old FPO data .debug$F sections. These are relatively rare.
-      ArrayRef<uint8_t> relocatedDebugContents =
-          relocateDebugChunk(*debugChunk);
-      FixedStreamArray<object::FpoData> fpoRecords;
-      BinaryStreamReader reader(relocatedDebugContents,
-                                llvm::endianness::little);
-      uint32_t count = relocatedDebugContents.size() / sizeof(object::FpoData);
-      exitOnErr(reader.readArray(fpoRecords, count));
-
-      // These are already relocated and don't refer to the string table, so we
-      // can just copy it.
-      for (const object::FpoData &fd : fpoRecords)
-        dbiBuilder.addOldFpoData(fd);
-    }
-  }
-
-  // Do any post-processing now that all .debug$S sections have been processed.
-  dsh.finish();
-}
-
 // Add a module descriptor for every object file. We need to put an absolute
 // path to the object into the PDB. If this is a plain object, we make its
 // path absolute. If it's an object in an archive, we make the archive path
@@ -1092,32 +1144,54 @@ void PDBLinker::createModuleDBI(ObjFile *file) {
   }
 }
 
-void PDBLinker::addDebug(TpiSource *source) {
-  // Before we can process symbol substreams from .debug$S, we need to process
-  // type information, file checksums, and the string table. Add type info to
-  // the PDB first, so that we can get the map from object file type and item
-  // indices to PDB type and item indices.  If we are using ghashes, types have
-  // already been merged.
-  if (!ctx.config.debugGHashes) {
-    llvm::TimeTraceScope timeScope("Merge types (Non-GHASH)");
-    ScopedTimer t(ctx.typeMergingTimer);
-    if (Error e = source->mergeDebugT(&tMerger)) {
-      // If type merging failed, ignore the symbols.
-      warnUnusable(source->file, std::move(e),
+void PDBLinker::addDebug(ArrayRef<TpiSource *> sources) {
+  std::vector<DebugSHandler> handlers;
+  handlers.reserve(sources.size());
+  for (TpiSource *source : sources) {
+    // Before we can process symbol substreams from .debug$S, we need to
+    // process type information, file checksums, and the string table. Add type
+    // info to the PDB first, so that we can get the map from object file type
+    // and item indices to PDB type and item indices.  If we are using ghashes,
+    // types have already been merged.
+    if (!ctx.config.debugGHashes) {
+      llvm::TimeTraceScope timeScope("Merge types (Non-GHASH)");
+      ScopedTimer t(ctx.typeMergingTimer);
+      if (Error e = source->mergeDebugT(&tMerger)) {
+        // If type merging failed, ignore the symbols.
+        warnUnusable(source->file, std::move(e),
+                     ctx.config.warnDebugInfoUnusable);
+        continue;
+      }
+    }
+
+    // If type merging failed, ignore the symbols.
+    Error typeError = std::move(source->typeMergingError);
+    if (typeError) {
+      warnUnusable(source->file, std::move(typeError),
                    ctx.config.warnDebugInfoUnusable);
-      return;
+      continue;
     }
-  }
 
-  // If type merging failed, ignore the symbols.
-  Error typeError = std::move(source->typeMergingError);
-  if (typeError) {
-    warnUnusable(source->file, std::move(typeError),
-                 ctx.config.warnDebugInfoUnusable);
-    return;
+    // If this TpiSource doesn't have an object file, it must be from a type
+    // server PDB. Type server PDBs do not contain symbols, so stop here.
+    if (!source->file)
+      continue;
+
+    // Sorting may allocate, so do it before the parallel analysis.
+    for (SectionChunk *debugChunk : source->file->getDebugChunks())
+      if (debugChunk->live && debugChunk->getSectionName() == ".debug$S")
+        debugChunk->sortRelocations();
+    handlers.emplace_back(ctx, *this, *source->file);
   }
 
-  addDebugSymbols(source);
+  llvm::TimeTraceScope timeScope("Merge symbols");
+  ScopedTimer t(ctx.symbolMergingTimer);
+  // Relocate and analyze the symbol records of each file in parallel, then
+  // report diagnostics and add the results to the PDB-wide streams in file
+  // order so that the output does not depend on the number of threads.
+  parallelForEach(handlers, [](DebugSHandler &dsh) { dsh.analyze(); });
+  for (DebugSHandler &dsh : handlers)
+    dsh.finish();
 }
 
 static pdb::BulkPublic createPublic(COFFLinkerContext &ctx, Defined *def) {
@@ -1162,13 +1236,11 @@ void PDBLinker::addObjectsToPDB() {
     // Merge dependencies and then regular objects.
     {
       llvm::TimeTraceScope timeScope("Merge debug info (dependencies)");
-      for (TpiSource *source : tMerger.dependencySources)
-        addDebug(source);
+      addDebug(tMerger.dependencySources);
     }
     {
       llvm::TimeTraceScope timeScope("Merge debug info (objects)");
-      for (TpiSource *source : tMerger.objectSources)
-        addDebug(source);
+      addDebug(tMerger.objectSources);
     }
 
     builder.getStringTableBuilder().setStrings(pdbStrTab);
@@ -1201,8 +1273,8 @@ void PDBLinker::addPublicsToPDB() {
   ScopedTimer t3(ctx.publicsLayoutTimer);
   // Compute the public symbols.
   auto &gsiBuilder = builder.getGsiBuilder();
-  std::vector<pdb::BulkPublic> publics;
-  ctx.symtab.forEachSymbol([&publics, this](Symbol *s) {
+  std::vector<Defined *> defs;
+  ctx.symtab.forEachSymbol([&defs, this](Symbol *s) {
     // Only emit external, defined, live symbols that have a chunk. Static,
     // non-external symbols do not appear in the symbol table.
     auto *def = dyn_cast<Defined>(s);
@@ -1223,10 +1295,14 @@ void PDBLinker::addPublicsToPDB() {
           return;
         }
       }
-      publics.push_back(createPublic(ctx, def));
+      defs.push_back(def);
     }
   });
 
+  std::vector<pdb::BulkPublic> publics(defs.size());
+  parallelFor(0, defs.size(),
+              [&](size_t i) { publics[i] = createPublic(ctx, defs[i]); });
+
   if (!publics.empty()) {
     publicSymbols = publics.size();
     gsiBuilder.addPublicSymbols(std::move(publics));
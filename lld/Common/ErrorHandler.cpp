@@ -248,6 +248,7 @@ void ErrorHandler::warn(const Twine &msg) {
 
   std::lock_guard<std::mutex> lock(mu);
   reportDiagnostic(getLocation(msg), Colors::MAGENTA, "warning", msg);
+  ++warningCount;
 }
 
 void ErrorHandler::error(const Twine &msg) {
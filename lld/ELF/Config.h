@@ -218,6 +218,7 @@ struct Config {
   uint8_t osabi = 0;
   uint32_t andFeatures = 0;
   llvm::CachePruningPolicy thinLTOCachePolicy;
+  llvm::CachePruningPolicy linkCachePolicy;
   llvm::SetVector<llvm::CachedHashString> dependencyFiles; // for --dependency-file
   llvm::StringMap<uint64_t> sectionStartMap;
   llvm::StringRef bfdname;
@@ -229,6 +230,7 @@ struct Config {
   llvm::StringRef emulation;
   llvm::StringRef fini;
   llvm::StringRef init;
+  llvm::StringRef linkCacheDir;
   llvm::StringRef ltoAAPipeline;
   llvm::StringRef ltoCSProfileFile;
   llvm::StringRef ltoNewPmPasses;
@@ -243,6 +245,7 @@ struct Config {
   llvm::StringRef optStatsFilename;
   llvm::StringRef progName;
   llvm::StringRef printArchiveStats;
+  llvm::StringRef printInputCosts;
   llvm::StringRef printSymbolOrder;
   llvm::StringRef soName;
   llvm::StringRef sysroot;
@@ -337,6 +340,8 @@ struct Config {
   bool gnuUnique;
   bool ignoreDataAddressEquality;
   bool ignoreFunctionAddressEquality;
+  bool incremental;
+  uint64_t incrementalPadding;
   bool ltoCSProfileGenerate;
   bool ltoPGOWarnMismatch;
   bool ltoDebugPassManager;
@@ -461,6 +466,10 @@ struct Config {
   // output file. Usually false because we consume relocations.
   bool copyRelocs;
 
+  // A hash of the command line, used by --incremental to detect option
+  // changes between links.
+  uint64_t incrementalArgsHash = 0;
+
   // True if the target is ELF64. False if ELF32.
   bool is64;
 
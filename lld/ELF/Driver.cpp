@@ -28,6 +28,7 @@
 #include "InputFiles.h"
 #include "InputSection.h"
 #include "LTO.h"
+#include "LinkCache.h"
 #include "LinkerScript.h"
 #include "MarkLive.h"
 #include "OutputSections.h"
@@ -65,6 +66,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include <cstdlib>
 #include <tuple>
 #include <utility>
@@ -261,14 +263,36 @@ void LinkerDriver::addFile(StringRef path, bool withLOption) {
     return;
   case file_magic::archive: {
     auto members = getArchiveMembers(ctx, mbref);
+    // Reading the symbol table of a bitcode member touches all of its pages
+    // (and may require parsing the module if it was written by an older
+    // producer), which dominates the time spent on archives of bitcode files.
+    // The members are created in order, but their symbol tables are read in
+    // parallel.
+    SmallVector<BitcodeFile *, 0> bitcodeFiles;
+    auto addBitcodeFile = [&](MemoryBufferRef mb, uint64_t offset, bool lazy) {
+      auto f = std::make_unique<BitcodeFile>(ctx, mb, path, offset, lazy,
+                                             /*deferInit=*/true);
+      bitcodeFiles.push_back(f.get());
+      files.push_back(std::move(f));
+    };
+    // Errors are reported serially in member order, so that the diagnostics
+    // do not depend on the thread scheduling.
+    auto initBitcodeFiles = [&] {
+      SmallVector<std::optional<Error>, 0> errs(bitcodeFiles.size());
+      parallelFor(0, bitcodeFiles.size(),
+                  [&](size_t i) { errs[i].emplace(bitcodeFiles[i]->init()); });
+      for (auto [f, err] : llvm::zip_equal(bitcodeFiles, errs))
+        f->finishInit(std::move(*err));
+    };
+
     if (inWholeArchive) {
       for (const std::pair<MemoryBufferRef, uint64_t> &p : members) {
         if (isBitcode(p.first))
-          files.push_back(std::make_unique<BitcodeFile>(ctx, p.first, path,
-                                                        p.second, false));
+          addBitcodeFile(p.first, p.second, false);
         else if (!tryAddFatLTOFile(p.first, path, p.second, false))
           files.push_back(createObjFile(ctx, p.first, path));
       }
+      initBitcodeFiles();
       return;
     }
 
@@ -293,13 +317,13 @@ void LinkerDriver::addFile(StringRef path, bool withLOption) {
         if (!tryAddFatLTOFile(p.first, path, p.second, true))
           files.push_back(createObjFile(ctx, p.first, path, true));
       } else if (magic == file_magic::bitcode)
-        files.push_back(
-            std::make_unique<BitcodeFile>(ctx, p.first, path, p.second, true));
+        addBitcodeFile(p.first, p.second, true);
       else
         Warn(ctx) << path << ": archive member '"
                   << p.first.getBufferIdentifier()
                   << "' is neither ET_REL nor LLVM bitcode";
     }
+    initBitcodeFiles();
     if (!saved.get())
       ++nextGroupId;
     return;
@@ -452,6 +476,15 @@ static void checkOptions(Ctx &ctx) {
   if (ctx.arg.strip == StripPolicy::All && ctx.arg.emitRelocs)
     ErrAlways(ctx) << "--strip-all and --emit-relocs may not be used together";
 
+  if (ctx.arg.incremental) {
+    if (ctx.arg.emitRelocs)
+      ErrAlways(ctx)
+          << "--incremental and --emit-relocs may not be used together";
+    if (ctx.arg.oFormatBinary)
+      ErrAlways(ctx)
+          << "--incremental and --oformat=binary may not be used together";
+  }
+
   if (ctx.arg.zText && ctx.arg.zIfuncNoplt)
     ErrAlways(ctx) << "-z text and -z ifunc-noplt may not be used together";
 
@@ -462,6 +495,8 @@ static void checkOptions(Ctx &ctx) {
       ErrAlways(ctx) << "-r and --gdb-index may not be used together";
     if (ctx.arg.icf != ICFLevel::None)
       ErrAlways(ctx) << "-r and --icf may not be used together";
+    if (ctx.arg.incremental)
+      ErrAlways(ctx) << "-r and --incremental may not be used together";
     if (ctx.arg.pie)
       ErrAlways(ctx) << "-r and -pie may not be used together";
     if (ctx.arg.exportDynamic)
@@ -726,7 +761,15 @@ void LinkerDriver::linkerMain(ArrayRef<const char *> argsArr) {
     if (errCount(ctx))
       return;
 
-    invokeELFT(link, args);
+    if (ctx.arg.linkCacheDir.empty()) {
+      invokeELFT(link, args);
+    } else {
+      LinkCache cache(ctx, args);
+      if (!cache.restore()) {
+        invokeELFT(link, args);
+        cache.save();
+      }
+    }
   }
 
   if (ctx.arg.timeTraceEnabled) {
@@ -1439,6 +1482,18 @@ static void readConfigs(Ctx &ctx, opt::InputArgList &args) {
       args.hasArg(OPT_ignore_data_address_equality);
   ctx.arg.ignoreFunctionAddressEquality =
       args.hasArg(OPT_ignore_function_address_equality);
+  ctx.arg.incremental =
+      args.hasFlag(OPT_incremental, OPT_no_incremental, false);
+  ctx.arg.incrementalPadding =
+      args::getInteger(args, OPT_incremental_padding, 0);
+  if (ctx.arg.incrementalPadding && !isPowerOf2_64(ctx.arg.incrementalPadding))
+    ErrAlways(ctx) << "--incremental-padding: value isn't a power of 2";
+  if (ctx.arg.incremental) {
+    std::string cmdline;
+    for (const opt::Arg *arg : args)
+      cmdline += arg->getAsString(args) + '\0';
+    ctx.arg.incrementalArgsHash = xxh3_64bits(cmdline);
+  }
   ctx.arg.init = args.getLastArgValue(OPT_init, "_init");
   ctx.arg.ltoAAPipeline = args.getLastArgValue(OPT_lto_aa_pipeline);
   ctx.arg.ltoCSProfileGenerate = args.hasArg(OPT_lto_cs_profile_generate);
@@ -1514,6 +1569,7 @@ static void readConfigs(Ctx &ctx, opt::InputArgList &args) {
       args.hasFlag(OPT_print_gc_sections, OPT_no_print_gc_sections, false);
   ctx.arg.printMemoryUsage = args.hasArg(OPT_print_memory_usage);
   ctx.arg.printArchiveStats = args.getLastArgValue(OPT_print_archive_stats);
+  ctx.arg.printInputCosts = args.getLastArgValue(OPT_print_input_costs);
   ctx.arg.printSymbolOrder = args.getLastArgValue(OPT_print_symbol_order);
   ctx.arg.rejectMismatch = !args.hasArg(OPT_no_warn_mismatch);
   ctx.arg.relax = args.hasFlag(OPT_relax, OPT_no_relax, true);
@@ -1558,6 +1614,10 @@ static void readConfigs(Ctx &ctx, opt::InputArgList &args) {
   ctx.arg.thinLTOCachePolicy = CHECK(
       parseCachePruningPolicy(args.getLastArgValue(OPT_thinlto_cache_policy)),
       "--thinlto-cache-policy: invalid cache policy");
+  ctx.arg.linkCacheDir = args.getLastArgValue(OPT_link_cache_dir);
+  ctx.arg.linkCachePolicy = CHECK(
+      parseCachePruningPolicy(args.getLastArgValue(OPT_link_cache_policy)),
+      "--link-cache-policy: invalid cache policy");
   ctx.arg.thinLTOEmitImportsFiles = args.hasArg(OPT_thinlto_emit_imports_files);
   ctx.arg.thinLTOEmitIndexFiles = args.hasArg(OPT_thinlto_emit_index_files) ||
                                   args.hasArg(OPT_thinlto_index_only) ||
@@ -2400,6 +2460,88 @@ static void writeArchiveStats(Ctx &ctx) {
   }
 }
 
+// Write the costs collected for --print-input-costs=, most expensive first.
+// An archive gets a row of its own that sums the costs of its members,
+// including members that were not extracted.
+static void
+writeInputCosts(Ctx &ctx, ArrayRef<std::unique_ptr<InputFile>> files,
+                ArrayRef<std::unique_ptr<InputFile>> ltoObjectFiles) {
+  if (ctx.arg.printInputCosts.empty())
+    return;
+  llvm::TimeTraceScope timeScope("Write input costs");
+
+  struct Row {
+    StringRef kind;
+    std::string name;
+    uint64_t nanoseconds[InputCost::NumPhases] = {};
+    uint64_t inputBytes = 0, outputBytes = 0, foldedBytes = 0;
+    uint64_t total() const {
+      return nanoseconds[InputCost::Parse] +
+             nanoseconds[InputCost::ScanRelocs] +
+             nanoseconds[InputCost::Write];
+    }
+    void add(const InputFile &file) {
+      for (int i = 0; i != InputCost::NumPhases; ++i)
+        nanoseconds[i] += file.cost.nanoseconds[i];
+      inputBytes += file.mb.getBufferSize();
+      outputBytes += file.cost.outputBytes;
+      foldedBytes += file.cost.foldedBytes;
+    }
+  };
+
+  SmallVector<Row, 0> rows;
+  DenseMap<CachedHashStringRef, size_t> archives;
+  auto add = [&](const InputFile &file) {
+    Row &row = rows.emplace_back();
+    row.kind = "file";
+    row.name = toStr(ctx, &file);
+    row.add(file);
+    if (file.archiveName.empty())
+      return;
+    auto [it, inserted] =
+        archives.try_emplace(CachedHashStringRef(file.archiveName), 0);
+    if (inserted) {
+      it->second = rows.size();
+      Row &archive = rows.emplace_back();
+      archive.kind = "archive";
+      archive.name = file.archiveName.str();
+    }
+    rows[it->second].add(file);
+  };
+  for (const std::unique_ptr<InputFile> &file : files)
+    add(*file);
+  for (const std::unique_ptr<InputFile> &file : ltoObjectFiles)
+    add(*file);
+  llvm::stable_sort(
+      rows, [](const Row &a, const Row &b) { return a.total() > b.total(); });
+
+  std::error_code ec;
+  raw_fd_ostream os = ctx.openAuxiliaryFile(ctx.arg.printInputCosts, ec);
+  if (ec) {
+    ErrAlways(ctx) << "--print-input-costs=: cannot open "
+                   << ctx.arg.printInputCosts << ": " << ec.message();
+    return;
+  }
+
+  auto ms = [](uint64_t ns) { return format("%.3f", ns / 1e6); };
+  os << "kind\ttotal_ms\tparse_ms\tscan_relocs_ms\twrite_ms\tinput_bytes\t"
+        "output_bytes\tfolded_bytes\tname\n";
+  for (const Row &row : rows) {
+    os << row.kind << '\t' << ms(row.total()) << '\t'
+       << ms(row.nanoseconds[InputCost::Parse]) << '\t'
+       << ms(row.nanoseconds[InputCost::ScanRelocs]) << '\t'
+       << ms(row.nanoseconds[InputCost::Write]) << '\t' << row.inputBytes
+       << '\t' << row.outputBytes << '\t' << row.foldedBytes << '\t'
+       << row.name << '\n';
+    // Make the costs visible in --time-trace output as well. The spans of the
+    // parallel passes cannot be attributed to files directly.
+    if (timeTraceProfilerEnabled())
+      timeTraceAddInstantEvent("Input cost", [&] {
+        return (row.name + ": " + Twine(row.total() / 1000) + " us").str();
+      });
+  }
+}
+
 static void writeWhyExtract(Ctx &ctx) {
   if (ctx.arg.whyExtract.empty())
     return;
@@ -3494,4 +3636,5 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
 
   // Write the result to the file.
   writeResult<ELFT>(ctx);
+  writeInputCosts(ctx, files, ltoObjectFiles);
 }
@@ -38,6 +38,10 @@
 //    account. We just put sections that apparently differ into different
 //    equivalence classes.
 //
+//    Most sections in a large program have unique hash values. They cannot
+//    be merged with anything, so we drop them from the set of candidates
+//    right away.
+//
 // 2. Next, for each equivalence class, we visit sections to compare
 //    relocation targets. Relocation targets are considered equivalent if
 //    their targets are in the same equivalence class. Sections with
@@ -47,7 +51,9 @@
 // 3. If we split an equivalence class in step 2, two relocations
 //    previously target the same equivalence class may now target
 //    different equivalence classes. Therefore, we repeat step 2 until a
-//    convergence is obtained.
+//    convergence is obtained. Sections that end up in equivalence classes
+//    of their own are dropped from the candidates after each iteration, so
+//    later iterations visit fewer sections.
 //
 // 4. For each equivalence class C, pick an arbitrary section in C, and
 //    merge all the other sections in C with it.
@@ -120,6 +126,8 @@ private:
 
   void parallelForEachClass(llvm::function_ref<void(size_t, size_t)> fn);
 
+  size_t removeSingletons(int slot);
+
   Ctx &ctx;
   SmallVector<InputSection *, 0> sections;
 
@@ -155,6 +163,11 @@ private:
   // faster because it uses results of the same iteration earlier.
   int current = 0;
   int next = 0;
+
+  // Whether to use threads. This is decided once before the first iteration,
+  // since singleton removal shrinks Sections between iterations, and the
+  // single-thread mode requires Current and Next to be the same slot.
+  bool useThreads = false;
 };
 }
 
@@ -414,7 +427,7 @@ void ICF<ELFT>::parallelForEachClass(
     llvm::function_ref<void(size_t, size_t)> fn) {
   // If threading is disabled or the number of sections are
   // too small to use threading, call Fn sequentially.
-  if (parallel::strategy.ThreadsRequested == 1 || sections.size() < 1024) {
+  if (!useThreads) {
     forEachClassRange(0, sections.size(), fn);
     ++cnt;
     return;
@@ -444,6 +457,29 @@ void ICF<ELFT>::parallelForEachClass(
   ++cnt;
 }
 
+// Removes sections that are the only members of their equivalence classes
+// (read from `slot`) from Sections. Such a section cannot be merged, and its
+// equivalence class never changes, so it only needs to have the same value in
+// both slots. Returns the number of removed sections.
+template <class ELFT> size_t ICF<ELFT>::removeSingletons(int slot) {
+  size_t out = 0;
+  for (size_t begin = 0, end; begin != sections.size(); begin = end) {
+    uint32_t eqClass = sections[begin]->eqClass[slot];
+    end = begin + 1;
+    while (end != sections.size() && sections[end]->eqClass[slot] == eqClass)
+      ++end;
+    if (end - begin == 1) {
+      sections[begin]->eqClass[slot ^ 1] = eqClass;
+      continue;
+    }
+    for (size_t i = begin; i != end; ++i)
+      sections[out++] = sections[i];
+  }
+  size_t numRemoved = sections.size() - out;
+  sections.resize(out);
+  return numRemoved;
+}
+
 // Combine the hashes of the sections referenced by the given section into its
 // hash.
 template <class RelTy>
@@ -488,50 +524,87 @@ template <class ELFT> void ICF<ELFT>::run() {
     }
   }
 
-  // Initially, we use hash values to partition sections.
-  parallelForEach(sections, [&](InputSection *s) {
-    // Set MSB to 1 to avoid collisions with unique IDs.
-    s->eqClass[0] = xxh3_64bits(s->content()) | (1U << 31);
-  });
+  size_t numEligible = sections.size();
+  {
+    llvm::TimeTraceScope timeScope("Hash sections");
 
-  // Perform 2 rounds of relocation hash propagation. 2 is an empirical value to
-  // reduce the average sizes of equivalence classes, i.e. segregate() which has
-  // a large time complexity will have less work to do.
-  for (unsigned cnt = 0; cnt != 2; ++cnt) {
+    // Initially, we use hash values to partition sections.
     parallelForEach(sections, [&](InputSection *s) {
-      const RelsOrRelas<ELFT> rels = s->template relsOrRelas<ELFT>();
-      if (rels.areRelocsCrel())
-        combineRelocHashes(cnt, s, rels.crels);
-      else if (rels.areRelocsRel())
-        combineRelocHashes(cnt, s, rels.rels);
-      else
-        combineRelocHashes(cnt, s, rels.relas);
+      // Set MSB to 1 to avoid collisions with unique IDs.
+      s->eqClass[0] = xxh3_64bits(s->content()) | (1U << 31);
     });
-  }
 
-  // From now on, sections in Sections vector are ordered so that sections
-  // in the same equivalence class are consecutive in the vector.
-  llvm::stable_sort(sections, [](const InputSection *a, const InputSection *b) {
-    return a->eqClass[0] < b->eqClass[0];
-  });
+    // Perform 2 rounds of relocation hash propagation. 2 is an empirical value
+    // to reduce the average sizes of equivalence classes, i.e. segregate()
+    // which has a large time complexity will have less work to do.
+    for (unsigned cnt = 0; cnt != 2; ++cnt) {
+      parallelForEach(sections, [&](InputSection *s) {
+        const RelsOrRelas<ELFT> rels = s->template relsOrRelas<ELFT>();
+        if (rels.areRelocsCrel())
+          combineRelocHashes(cnt, s, rels.crels);
+        else if (rels.areRelocsRel())
+          combineRelocHashes(cnt, s, rels.rels);
+        else
+          combineRelocHashes(cnt, s, rels.relas);
+      });
+    }
+
+    // From now on, sections in Sections vector are ordered so that sections
+    // in the same equivalence class are consecutive in the vector.
+    llvm::stable_sort(sections,
+                      [](const InputSection *a, const InputSection *b) {
+                        return a->eqClass[0] < b->eqClass[0];
+                      });
+
+    // Identical sections have identical hash values, so sections with unique
+    // hash values keep them as their equivalence class IDs. The IDs have MSB
+    // set, so they cannot collide with the IDs assigned below.
+    removeSingletons(0);
+  }
+  Log(ctx) << "ICF: " << sections.size() << " of " << numEligible
+           << " eligible sections remain after hashing";
 
   // Compare static contents and assign unique equivalence class IDs for each
   // static content. Use a base offset for these IDs to ensure no overlap with
   // the unique IDs already assigned.
+  //
+  // IDs are derived from indices into Sections, which change when singletons
+  // are removed. The base is advanced past all IDs assigned so far whenever
+  // that happens, so that the remaining classes get IDs not used by any of the
+  // removed sections.
   uint32_t eqClassBase = ++uniqueId;
-  parallelForEachClass([&](size_t begin, size_t end) {
-    segregate(begin, end, eqClassBase, true);
-  });
+  useThreads =
+      parallel::strategy.ThreadsRequested != 1 && sections.size() >= 1024;
+  auto shrink = [&] {
+    size_t size = sections.size();
+    if (removeSingletons(next))
+      eqClassBase += size;
+  };
 
-  // Split groups by comparing relocations until convergence is obtained.
-  do {
-    repeat = false;
+  {
+    llvm::TimeTraceScope timeScope("Compare section contents");
     parallelForEachClass([&](size_t begin, size_t end) {
-      segregate(begin, end, eqClassBase, false);
+      segregate(begin, end, eqClassBase, true);
     });
-  } while (repeat);
+    shrink();
+  }
+  Log(ctx) << "ICF: " << sections.size()
+           << " sections remain after comparing contents";
+
+  // Split groups by comparing relocations until convergence is obtained.
+  {
+    llvm::TimeTraceScope timeScope("Compare relocation targets");
+    do {
+      repeat = false;
+      parallelForEachClass([&](size_t begin, size_t end) {
+        segregate(begin, end, eqClassBase, false);
+      });
+      shrink();
+    } while (repeat);
+  }
 
-  Log(ctx) << "ICF needed " << cnt << " iterations";
+  Log(ctx) << "ICF needed " << cnt << " iterations; " << sections.size()
+           << " sections are foldable";
 
   auto print = [&ctx = ctx]() -> ELFSyncStream {
     return {ctx, ctx.arg.printIcfSections ? DiagLevel::Msg : DiagLevel::None};
@@ -543,6 +616,8 @@ template <class ELFT> void ICF<ELFT>::run() {
     print() << "selected section " << sections[begin];
     for (size_t i = begin + 1; i < end; ++i) {
       print() << "  removing identical section " << sections[i];
+      if (!ctx.arg.printInputCosts.empty())
+        sections[i]->file->cost.foldedBytes += sections[i]->getSize();
       sections[begin]->replace(sections[i]);
 
       // At this point we know sections merged are fully identical and hence
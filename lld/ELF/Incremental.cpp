@@ -0,0 +1,339 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --incremental, which lets a relink update the previous
+// output file in place when only some input sections changed.
+//
+// The memory image of the output must not move: every SHF_ALLOC output
+// section must have the same address, size and file offset as in the previous
+// link. This is what makes it possible to keep the bytes of unchanged input
+// sections, since relocations to and from them still resolve to the same
+// values. --incremental-padding can be used to give executable input sections
+// room to grow without moving their successors.
+//
+// Non-SHF_ALLOC sections (typically debug info) may move. Everything in the
+// file after the first section whose offset or size changed is written again.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "LinkerScript.h"
+#include "OutputSections.h"
+#include "Relocations.h"
+#include "Symbols.h"
+#include "Target.h"
+#include "lld/Common/Version.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+using namespace llvm::support;
+using namespace lld;
+using namespace lld::elf;
+
+// "LLDINCR" followed by a format version.
+static constexpr uint64_t stateMagic = 0x0152434e49444c4cULL;
+
+IncrementalLink::IncrementalLink(Ctx &ctx)
+    : ctx(ctx), statePath((ctx.arg.outputFile + ".lld-incr").str()) {}
+
+// Appends the values a relocation to `sym` may resolve to.
+static void addSymbol(Ctx &ctx, SmallVectorImpl<uint64_t> &buf,
+                      const Symbol &sym, int64_t addend) {
+  const SymbolAux &aux = ctx.symAux[sym.auxIdx];
+  buf.push_back(sym.getVA(ctx, addend));
+  buf.push_back(sym.getSize());
+  buf.push_back(uint64_t(aux.gotIdx) << 32 | aux.pltIdx);
+  buf.push_back(uint64_t(aux.tlsDescIdx) << 32 | aux.tlsGdIdx);
+  buf.push_back(sym.isPreemptible | sym.isInIplt << 1 | sym.gotInIgot << 2);
+}
+
+template <class ELFT, class RelTy>
+static void addNonAllocRelocs(Ctx &ctx, SmallVectorImpl<uint64_t> &buf,
+                              const InputSection &sec, ArrayRef<uint8_t> data,
+                              Relocs<RelTy> rels) {
+  const InputFile *f = sec.file;
+  for (const RelTy &rel : rels) {
+    const RelType type = rel.getType(ctx.arg.isMips64EL);
+    int64_t addend = getAddend<ELFT>(rel);
+    if (!RelTy::HasAddend && rel.r_offset < data.size())
+      addend += ctx.target->getImplicitAddend(data.data() + rel.r_offset, type);
+    Symbol &sym = f->getRelocTargetSym(rel);
+    auto *ds = dyn_cast<Defined>(&sym);
+    buf.push_back(type);
+    buf.push_back(rel.r_offset);
+    buf.push_back(ds ? ds->folded : 2);
+    addSymbol(ctx, buf, sym, addend);
+  }
+}
+
+// Computes a key that changes whenever the bytes `isec` contributes to the
+// output may change. Returns 0 if the section must always be written.
+template <class ELFT>
+static uint64_t computeKey(Ctx &ctx, const OutputSection &osec,
+                           const InputSection &isec) {
+  if (isec.kind() != SectionBase::Regular)
+    return 0;
+  // Split-stack prologue adjustment depends on properties of the callees.
+  if (auto *f = dyn_cast_or_null<ObjFile<ELFT>>(isec.file))
+    if ((isec.flags & SHF_EXECINSTR) && f->splitStack)
+      return 0;
+
+  ArrayRef<uint8_t> data = isec.contentMaybeDecompress();
+  SmallVector<uint64_t, 0> buf;
+  buf.push_back(xxh3_64bits(data));
+  buf.push_back(osec.addr + isec.outSecOff);
+  buf.push_back(isec.outSecOff);
+  buf.push_back(isec.getSize());
+  if (isec.flags & SHF_ALLOC) {
+    for (const Relocation &r : isec.relocs()) {
+      buf.push_back(uint64_t(r.expr) << 32 | r.type);
+      buf.push_back(r.offset);
+      buf.push_back(r.addend);
+      addSymbol(ctx, buf, *r.sym, r.addend);
+    }
+  } else {
+    invokeOnRelocs(isec, addNonAllocRelocs<ELFT>, ctx, buf, isec, data);
+  }
+  return xxh3_64bits(ArrayRef(reinterpret_cast<const uint8_t *>(buf.data()),
+                              buf.size() * sizeof(uint64_t))) |
+         1;
+}
+
+// Returns true if `osec` cannot be written piecewise.
+static bool mustWriteWhole(const OutputSection &osec) {
+  if (osec.type == SHT_NOBITS || osec.type == SHT_CREL ||
+      isStaticRelSecType(osec.type) || osec.compressed.shards)
+    return true;
+  // BYTE() and friends are written on top of the input sections.
+  return llvm::any_of(osec.commands, [](SectionCommand *cmd) {
+    return isa<ByteCommand>(cmd);
+  });
+}
+
+// Some targets rewrite instructions based on information that is not
+// captured by content keys (e.g. linker relaxation that shrinks code). Only
+// reuse the previous output for targets known not to do that.
+static bool supportsReuse(Ctx &ctx) {
+  if (ctx.arg.optimizeBBJumps)
+    return false;
+  switch (ctx.arg.emachine) {
+  case EM_386:
+  case EM_AARCH64:
+  case EM_X86_64:
+    return true;
+  default:
+    return false;
+  }
+}
+
+template <class ELFT> void IncrementalLink::prepare(uint64_t fileSize) {
+  llvm::TimeTraceScope timeScope("Compute incremental state");
+  SmallVector<uint64_t, 0> layout = {xxh3_64bits(getLLDVersion()),
+                                     ctx.arg.incrementalArgsHash,
+                                     ctx.arg.ekind, ctx.arg.emachine,
+                                     uint64_t(ctx.outputSections.size())};
+  sections.resize(ctx.outputSections.size());
+  for (auto [osec, s] : llvm::zip(ctx.outputSections, sections)) {
+    s.nameHash = xxh3_64bits(osec->name);
+    s.offset = osec->offset;
+    s.size = osec->size;
+    if (osec->flags & SHF_ALLOC)
+      layout.append({s.nameHash, osec->type, osec->flags, osec->addr,
+                     osec->size, osec->offset});
+
+    s.alwaysWrite = mustWriteWhole(*osec);
+    if (s.alwaysWrite)
+      continue;
+    SmallVector<InputSection *, 0> storage;
+    ArrayRef<InputSection *> isecs = getInputSections(*osec, storage);
+    s.keys.resize(isecs.size());
+    parallelFor(0, isecs.size(), [&, osec = osec, &s = s](size_t i) {
+      s.keys[i] = computeKey<ELFT>(ctx, *osec, *isecs[i]);
+    });
+  }
+  layoutHash = xxh3_64bits(ArrayRef(
+      reinterpret_cast<const uint8_t *>(layout.data()),
+      layout.size() * sizeof(uint64_t)));
+
+  if (!supportsReuse(ctx))
+    return;
+  SmallVector<SectionState, 0> prev;
+  uint64_t prevFileSize;
+  if (loadState(prev, prevFileSize))
+    compare(prev, prevFileSize, fileSize);
+}
+
+// Reads the state file of the previous link. Returns false if it is missing,
+// malformed, does not describe the current output file, or was written for a
+// link with a different memory image layout.
+bool IncrementalLink::loadState(SmallVectorImpl<SectionState> &prev,
+                                uint64_t &prevFileSize) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(statePath, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (!mbOrErr)
+    return false;
+  ArrayRef<uint8_t> data = arrayRefFromStringRef((*mbOrErr)->getBuffer());
+  auto next = [&](uint64_t &v) {
+    if (data.size() < sizeof(uint64_t))
+      return false;
+    v = endian::read64le(data.data());
+    data = data.drop_front(sizeof(uint64_t));
+    return true;
+  };
+
+  uint64_t magic, hash, mtime, device, file, numSections;
+  if (!next(magic) || magic != stateMagic || !next(hash) ||
+      hash != layoutHash || !next(prevFileSize) || !next(mtime) ||
+      !next(device) || !next(file) || !next(numSections) ||
+      numSections != sections.size())
+    return false;
+
+  // The output file must be the one we wrote last time. Do not modify a file
+  // that has other hard links, since they would observe the update.
+  sys::fs::file_status st;
+  if (sys::fs::status(ctx.arg.outputFile, st) ||
+      st.type() != sys::fs::file_type::regular_file ||
+      st.getLinkCount() != 1 || st.getSize() != prevFileSize ||
+      uint64_t(st.getLastModificationTime().time_since_epoch().count()) !=
+          mtime ||
+      st.getUniqueID().getDevice() != device ||
+      st.getUniqueID().getFile() != file)
+    return false;
+
+  prev.resize(numSections);
+  for (SectionState &s : prev) {
+    uint64_t alwaysWrite, numKeys;
+    if (!next(s.nameHash) || !next(s.offset) || !next(s.size) ||
+        !next(alwaysWrite) || !next(numKeys) ||
+        numKeys > data.size() / sizeof(uint64_t))
+      return false;
+    s.alwaysWrite = alwaysWrite;
+    s.keys.resize(numKeys);
+    for (uint64_t &key : s.keys)
+      next(key);
+  }
+  return data.empty();
+}
+
+void IncrementalLink::compare(ArrayRef<SectionState> prev,
+                              uint64_t prevFileSize, uint64_t fileSize) {
+  staleOffset = fileSize;
+  if (fileSize != prevFileSize)
+    staleOffset = std::min(fileSize, prevFileSize);
+  for (auto [s, p] : llvm::zip(sections, prev)) {
+    if (s.nameHash != p.nameHash)
+      return;
+    if (s.offset != p.offset || s.size != p.size)
+      staleOffset = std::min({staleOffset, s.offset, p.offset});
+  }
+
+  size_t numKeys = 0, numDirty = 0;
+  for (auto [osec, s, p] : llvm::zip(ctx.outputSections, sections, prev)) {
+    numKeys += s.keys.size();
+    if (s.alwaysWrite || p.alwaysWrite || s.keys.size() != p.keys.size() ||
+        (osec->type != SHT_NOBITS && s.offset + s.size > staleOffset)) {
+      s.status = Status::Full;
+      numDirty += s.keys.size();
+      continue;
+    }
+    s.dirty.resize(s.keys.size());
+    for (size_t i = 0, e = s.keys.size(); i != e; ++i)
+      if (s.keys[i] == 0 || s.keys[i] != p.keys[i])
+        s.dirty.set(i);
+    size_t n = s.dirty.count();
+    numDirty += n;
+    if (n == 0)
+      s.status = Status::Clean;
+    else if (n == s.keys.size())
+      s.status = Status::Full;
+    else
+      s.status = Status::Partial;
+  }
+  reuse = true;
+  Log(ctx) << "--incremental: updating " << ctx.arg.outputFile
+           << " in place, rewriting " << numDirty << " of " << numKeys
+           << " input sections";
+}
+
+void IncrementalLink::clearStaleRange(uint8_t *buf, uint64_t fileSize) const {
+  if (!reuse)
+    return;
+  if (staleOffset < fileSize)
+    memset(buf + staleOffset, 0, fileSize - staleOffset);
+  // Sections written as a whole expect zero-initialized gaps, as in a new
+  // file.
+  for (auto [osec, s] : llvm::zip(ctx.outputSections, sections))
+    if (s.status == Status::Full && osec->type != SHT_NOBITS &&
+        s.offset < staleOffset)
+      memset(buf + s.offset, 0, s.size);
+}
+
+bool IncrementalLink::isClean(const OutputSection *osec) const {
+  return reuse && sections[osec->sectionIndex - 1].status == Status::Clean;
+}
+
+const BitVector *
+IncrementalLink::getDirtyInputSections(const OutputSection *osec) const {
+  if (!reuse)
+    return nullptr;
+  const SectionState &s = sections[osec->sectionIndex - 1];
+  return s.status == Status::Partial ? &s.dirty : nullptr;
+}
+
+void IncrementalLink::removeState() { sys::fs::remove(statePath); }
+
+void IncrementalLink::saveState() {
+  if (ctx.e.disableOutput || !supportsReuse(ctx))
+    return;
+  sys::fs::file_status st;
+  if (sys::fs::status(ctx.arg.outputFile, st))
+    return;
+
+  std::error_code ec;
+  raw_fd_ostream os(statePath, ec, sys::fs::OF_None);
+  if (ec) {
+    Warn(ctx) << "cannot open " << statePath << ": " << ec.message();
+    return;
+  }
+  auto write = [&](uint64_t v) {
+    endian::write<uint64_t>(os, v, llvm::endianness::little);
+  };
+  write(stateMagic);
+  write(layoutHash);
+  write(st.getSize());
+  write(st.getLastModificationTime().time_since_epoch().count());
+  write(st.getUniqueID().getDevice());
+  write(st.getUniqueID().getFile());
+  write(sections.size());
+  for (const SectionState &s : sections) {
+    write(s.nameHash);
+    write(s.offset);
+    write(s.size);
+    write(s.alwaysWrite);
+    write(s.keys.size());
+    for (uint64_t key : s.keys)
+      write(key);
+  }
+}
+
+template void IncrementalLink::prepare<ELF32LE>(uint64_t);
+template void IncrementalLink::prepare<ELF32BE>(uint64_t);
+template void IncrementalLink::prepare<ELF64LE>(uint64_t);
+template void IncrementalLink::prepare<ELF64BE>(uint64_t);
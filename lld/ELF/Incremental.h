@@ -0,0 +1,99 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_INCREMENTAL_H
+#define LLD_ELF_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include <string>
+
+namespace lld::elf {
+struct Ctx;
+class OutputSection;
+
+// Implements --incremental. After a successful link, a state file is written
+// next to the output. It records the layout of the output and a content key
+// for every input section. A content key covers the section contents, its
+// location, and the resolved values of its relocation targets, so two equal
+// keys mean that the section's bytes in the output are identical.
+//
+// On the next link, if the memory image layout is unchanged and the previous
+// output file is still the one described by the state file, the output is
+// updated in place and only input sections whose keys differ are written.
+// Otherwise, the whole output is written as usual.
+class IncrementalLink {
+public:
+  IncrementalLink(Ctx &ctx);
+
+  // Computes content keys for the current link and compares them with the
+  // state of the previous link. Must be called after file offsets have been
+  // assigned.
+  template <class ELFT> void prepare(uint64_t fileSize);
+
+  // Returns true if the previous output file can be updated in place.
+  bool canReuseOutput() const { return reuse; }
+
+  // Called if the previous output file could not be opened for update.
+  void disableReuse() { reuse = false; }
+
+  // Clears the parts of the reused output file that are written from scratch:
+  // the range whose layout changed and sections that are written as a whole.
+  void clearStaleRange(uint8_t *buf, uint64_t fileSize) const;
+
+  // Returns true if nothing in `osec` needs to be written.
+  bool isClean(const OutputSection *osec) const;
+
+  // Returns the input sections of `osec` that need to be written, or nullptr
+  // if the whole section needs to be written.
+  const llvm::BitVector *getDirtyInputSections(const OutputSection *osec) const;
+
+  // Removes the state file of the previous link. This must be done before the
+  // output file is modified.
+  void removeState();
+
+  // Writes the state file for the output file that has just been committed.
+  void saveState();
+
+private:
+  enum class Status : uint8_t { Clean, Partial, Full };
+
+  struct SectionState {
+    uint64_t nameHash = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    // If true, the section is written as a whole regardless of its keys.
+    bool alwaysWrite = false;
+    // One content key per input section. 0 means the input section is always
+    // written (e.g. synthetic sections).
+    SmallVector<uint64_t, 0> keys;
+
+    Status status = Status::Full;
+    llvm::BitVector dirty;
+  };
+
+  bool loadState(llvm::SmallVectorImpl<SectionState> &prev,
+                 uint64_t &prevFileSize);
+  void compare(ArrayRef<SectionState> prev, uint64_t prevFileSize,
+               uint64_t fileSize);
+
+  Ctx &ctx;
+  std::string statePath;
+  uint64_t layoutHash = 0;
+  // Parallel to ctx.outputSections.
+  SmallVector<SectionState, 0> sections;
+  // The start of the file range whose layout differs from the previous
+  // output. Everything from here to the end of the file is rewritten.
+  uint64_t staleOffset = 0;
+  bool reuse = false;
+};
+
+} // namespace lld::elf
+
+#endif
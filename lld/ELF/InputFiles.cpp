@@ -25,6 +25,7 @@
 #include "llvm/Support/ARMBuildAttributes.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
@@ -299,9 +300,12 @@ static bool isCompatible(Ctx &ctx, InputFile *file) {
   return false;
 }
 
+thread_local InputCostScope *InputCostScope::innermost = nullptr;
+
 template <class ELFT> static void doParseFile(Ctx &ctx, InputFile *file) {
   if (!isCompatible(ctx, file))
     return;
+  InputCostScope costScope(ctx, file, InputCost::Parse);
 
   // Lazy object file
   if (file->lazy) {
@@ -347,6 +351,20 @@ template <class ELFT>
 static void
 doParseFiles(Ctx &ctx,
              const SmallVector<std::unique_ptr<InputFile>, 0> &files) {
+  // Symbol resolution depends on the order of input files (e.g. archive
+  // member extraction), so files are parsed serially below. Looking up and
+  // creating global symbols by name is independent of the order, so do that
+  // for relocatable object files in parallel first.
+  {
+    llvm::TimeTraceScope timeScope("Preinsert symbols");
+    SmallVector<ObjFile<ELFT> *, 0> objs;
+    for (const std::unique_ptr<InputFile> &file : files)
+      if (file->kind() == InputFile::ObjKind && file->ekind == ctx.arg.ekind)
+        objs.push_back(cast<ObjFile<ELFT>>(file.get()));
+    parallelForEach(objs,
+                    [](ObjFile<ELFT> *file) { file->preinsertSymbols(); });
+  }
+
   // Add all files to the symbol table. This will add almost all symbols that we
   // need to the symbol table. This process might add files to the link due to
   // addDependentLibrary.
@@ -1140,11 +1158,14 @@ void ObjFile<ELFT>::initializeSymbols(const object::ELFFile<ELFT> &obj) {
   if (!symbols)
     symbols = std::make_unique<Symbol *[]>(numSymbols);
 
-  // Some entries have been filled by LazyObjFile.
+  // Some entries have been filled by LazyObjFile or preinsertSymbols.
   auto *symtab = ctx.symtab.get();
-  for (size_t i = firstGlobal, end = eSyms.size(); i != end; ++i)
+  for (size_t i = firstGlobal, end = eSyms.size(); i != end; ++i) {
     if (!symbols[i])
       symbols[i] = symtab->insert(CHECK2(eSyms[i].getName(stringTable), this));
+    else
+      symtab->addPending(symbols[i]);
+  }
 
   // Perform symbol resolution on non-local symbols.
   SmallVector<unsigned, 32> undefineds;
@@ -1754,7 +1775,7 @@ static uint8_t getOsAbi(const Triple &t) {
 }
 
 BitcodeFile::BitcodeFile(Ctx &ctx, MemoryBufferRef mb, StringRef archiveName,
-                         uint64_t offsetInArchive, bool lazy)
+                         uint64_t offsetInArchive, bool lazy, bool deferInit)
     : InputFile(ctx, BitcodeKind, mb) {
   this->archiveName = archiveName;
   this->lazy = lazy;
@@ -1774,9 +1795,23 @@ BitcodeFile::BitcodeFile(Ctx &ctx, MemoryBufferRef mb, StringRef archiveName,
                        ? ss.save(path)
                        : ss.save(archiveName + "(" + path::filename(path) +
                                  " at " + utostr(offsetInArchive) + ")");
-  MemoryBufferRef mbref(mb.getBuffer(), name);
+  ltoName = name;
+  if (!deferInit)
+    finishInit(init());
+}
+
+Error BitcodeFile::init() {
+  Expected<std::unique_ptr<lto::InputFile>> objOrErr =
+      lto::InputFile::create(MemoryBufferRef(mb.getBuffer(), ltoName));
+  if (!objOrErr)
+    return objOrErr.takeError();
+  obj = std::move(*objOrErr);
+  return Error::success();
+}
 
-  obj = CHECK2(lto::InputFile::create(mbref), this);
+void BitcodeFile::finishInit(Error err) {
+  if (err)
+    Fatal(ctx) << this << ": " << std::move(err);
 
   Triple t(obj->getTargetTriple());
   ekind = getBitcodeELFKind(t);
@@ -1957,7 +1992,8 @@ std::unique_ptr<ELFFileBase> elf::createObjFile(Ctx &ctx, MemoryBufferRef mb,
 template <class ELFT> void ObjFile<ELFT>::parseLazy() {
   const ArrayRef<typename ELFT::Sym> eSyms = this->getELFSyms<ELFT>();
   numSymbols = eSyms.size();
-  symbols = std::make_unique<Symbol *[]>(numSymbols);
+  if (!symbols)
+    symbols = std::make_unique<Symbol *[]>(numSymbols);
 
   // resolve() may trigger this->extract() if an existing symbol is an undefined
   // symbol. If that happens, this function has served its purpose, and we can
@@ -1966,13 +2002,35 @@ template <class ELFT> void ObjFile<ELFT>::parseLazy() {
   for (size_t i = firstGlobal, end = eSyms.size(); i != end; ++i) {
     if (eSyms[i].st_shndx == SHN_UNDEF)
       continue;
-    symbols[i] = symtab->insert(CHECK2(eSyms[i].getName(stringTable), this));
+    if (!symbols[i])
+      symbols[i] = symtab->insert(CHECK2(eSyms[i].getName(stringTable), this));
+    else
+      symtab->addPending(symbols[i]);
     symbols[i]->resolve(ctx, LazySymbol{*this});
     if (!lazy)
       break;
   }
 }
 
+template <class ELFT> void ObjFile<ELFT>::preinsertSymbols() {
+  const ArrayRef<typename ELFT::Sym> eSyms = this->getELFSyms<ELFT>();
+  symbols = std::make_unique<Symbol *[]>(numSymbols);
+  auto *symtab = ctx.symtab.get();
+  for (size_t i = firstGlobal, end = eSyms.size(); i != end; ++i) {
+    // parseLazy() only inserts defined symbols. Undefined symbols of an
+    // archive member are inserted when the member is extracted, if ever.
+    if (lazy && eSyms[i].st_shndx == SHN_UNDEF)
+      continue;
+    // Invalid names are diagnosed by the serial path.
+    Expected<StringRef> name = eSyms[i].getName(stringTable);
+    if (!name) {
+      consumeError(name.takeError());
+      continue;
+    }
+    symbols[i] = symtab->insertConcurrent(*name);
+  }
+}
+
 bool InputFile::shouldExtractForCommon(StringRef name) const {
   if (isa<BitcodeFile>(this))
     return isBitcodeNonCommonDef(mb, name, archiveName);
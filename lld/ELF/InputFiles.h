@@ -19,6 +19,8 @@
 #include "llvm/Object/ELF.h"
 #include "llvm/Support/MemoryBufferRef.h"
 #include "llvm/Support/Threading.h"
+#include <atomic>
+#include <chrono>
 
 namespace llvm {
 struct DILineInfo;
@@ -46,6 +48,38 @@ std::optional<MemoryBufferRef> readFile(Ctx &, StringRef path);
 void parseFile(Ctx &, InputFile *file);
 void parseFiles(Ctx &, const SmallVector<std::unique_ptr<InputFile>, 0> &);
 
+// Time and bytes attributed to an input file for --print-input-costs. The
+// counters are updated by parallel passes.
+struct InputCost {
+  enum Phase : uint8_t { Parse, ScanRelocs, Write, NumPhases };
+  std::atomic<uint64_t> nanoseconds[NumPhases] = {};
+  // Bytes of the file's sections written to the output.
+  std::atomic<uint64_t> outputBytes{0};
+  // Bytes of the file's sections folded into identical sections by ICF.
+  std::atomic<uint64_t> foldedBytes{0};
+};
+
+// Adds the time spent in its scope to a phase of the cost of `file` if
+// --print-input-costs is specified. Scopes may nest, e.g. parsing a file may
+// extract and parse an archive member. The time spent in a nested scope is
+// attributed to its file only, not to the files of the enclosing scopes.
+class InputCostScope {
+public:
+  InputCostScope(Ctx &ctx, InputFile *file, InputCost::Phase phase);
+  ~InputCostScope();
+
+private:
+  // The innermost active scope of this thread.
+  static thread_local InputCostScope *innermost;
+
+  InputFile *file;
+  InputCostScope *parent = nullptr;
+  InputCost::Phase phase;
+  std::chrono::steady_clock::time_point start;
+  // The time spent in nested scopes.
+  std::chrono::steady_clock::duration nested{0};
+};
+
 // The root class of input files.
 class InputFile {
 public:
@@ -170,11 +204,34 @@ public:
   // member.
   mutable SmallString<0> toStringCache;
 
+  InputCost cost;
+
 private:
   // Cache for getNameForScript().
   mutable SmallString<0> nameForScriptCache;
 };
 
+inline InputCostScope::InputCostScope(Ctx &ctx, InputFile *file,
+                                      InputCost::Phase phase)
+    : file(ctx.arg.printInputCosts.empty() ? nullptr : file), phase(phase) {
+  if (!this->file)
+    return;
+  parent = std::exchange(innermost, this);
+  start = std::chrono::steady_clock::now();
+}
+
+inline InputCostScope::~InputCostScope() {
+  if (!file)
+    return;
+  std::chrono::steady_clock::duration elapsed =
+      std::chrono::steady_clock::now() - start;
+  file->cost.nanoseconds[phase] +=
+      (elapsed - nested) / std::chrono::nanoseconds(1);
+  if (parent)
+    parent->nested += elapsed;
+  innermost = parent;
+}
+
 class ELFFileBase : public InputFile {
 public:
   ELFFileBase(Ctx &ctx, Kind k, ELFKind ekind, MemoryBufferRef m);
@@ -263,6 +320,11 @@ public:
   void parse(bool ignoreComdats = false);
   void parseLazy();
 
+  // Creates the global symbols that parse() or parseLazy() will insert, using
+  // SymbolTable::insertConcurrent. May be called in parallel for different
+  // files before they are parsed.
+  void preinsertSymbols();
+
   StringRef getShtGroupSignature(ArrayRef<Elf_Shdr> sections,
                                  const Elf_Shdr &sec);
 
@@ -324,13 +386,25 @@ private:
 class BitcodeFile : public InputFile {
 public:
   BitcodeFile(Ctx &, MemoryBufferRef m, StringRef archiveName,
-              uint64_t offsetInArchive, bool lazy);
+              uint64_t offsetInArchive, bool lazy, bool deferInit = false);
   static bool classof(const InputFile *f) { return f->kind() == BitcodeKind; }
+  // Reads the symbol table of the bitcode file. This is done by the
+  // constructor unless deferInit is true. It neither uses the linker context
+  // nor reports diagnostics, so it can be called for several files in
+  // parallel. Its result must then be passed to finishInit() serially.
+  llvm::Error init();
+  // Reports an error returned by init(), or sets the ELF kind, machine and
+  // OS ABI from the target triple of the bitcode file.
+  void finishInit(llvm::Error err);
   void parse();
   void parseLazy();
   void postParse();
   std::unique_ptr<llvm::lto::InputFile> obj;
   std::vector<bool> keptComdats;
+
+private:
+  // The unique name of the file given to LTO.
+  StringRef ltoName;
 };
 
 // .so file.
@@ -1419,15 +1419,40 @@ uint64_t EhInputSection::getParentOffset(uint64_t offset) const {
   return it[-1].outputOff + (offset - it[-1].inputOff);
 }
 
+// Returns true if the entSize bytes at p are all zero. Common entry sizes are
+// tested with a single load instead of a byte-by-byte loop.
+static bool isNullEntry(const char *p, size_t entSize) {
+  switch (entSize) {
+  case 2:
+    return read16le(p) == 0;
+  case 4:
+    return read32le(p) == 0;
+  case 8:
+    return read64le(p) == 0;
+  default:
+    return std::all_of(p, p + entSize, [](char c) { return c == 0; });
+  }
+}
+
 static size_t findNull(StringRef s, size_t entSize) {
-  for (unsigned i = 0, n = s.size(); i != n; i += entSize) {
-    const char *b = s.begin() + i;
-    if (std::all_of(b, b + entSize, [](char c) { return c == 0; }))
+  for (unsigned i = 0, n = s.size(); i != n; i += entSize)
+    if (isNullEntry(s.begin() + i, entSize))
       return i;
-  }
   llvm_unreachable("");
 }
 
+// Returns the number of null-terminated strings in s, which is the number of
+// null entries.
+static size_t countStrings(StringRef s, size_t entSize) {
+  // std::count over bytes is vectorized by compilers.
+  if (entSize == 1)
+    return std::count(s.begin(), s.end(), '\0');
+  size_t cnt = 0;
+  for (size_t i = 0, n = s.size(); i + entSize <= n; i += entSize)
+    cnt += isNullEntry(s.begin() + i, entSize);
+  return cnt;
+}
+
 // Split SHF_STRINGS section. Such section is a sequence of
 // null-terminated strings.
 void MergeInputSection::splitStrings(StringRef s, size_t entSize) {
@@ -1438,6 +1463,9 @@ void MergeInputSection::splitStrings(StringRef s, size_t entSize) {
     pieces.emplace_back(entSize, 0, false);
     return;
   }
+  // Sections such as .debug_str may contain millions of strings. Counting them
+  // first is much cheaper than growing pieces repeatedly.
+  pieces.reserve(countStrings(s, entSize));
   if (entSize == 1) {
     // Optimize the common case.
     do {
@@ -338,6 +338,13 @@ SmallVector<std::unique_ptr<InputFile>, 0> BitcodeCompiler::compile() {
                           },
                           cache));
 
+  if (const FileCacheStats *stats = cache.getStats()) {
+    std::string s;
+    raw_string_ostream os(s);
+    stats->print(os);
+    Log(ctx) << "--thinlto-cache-dir: " << s;
+  }
+
   // Emit empty index files for non-indexed files but not in single-module mode.
   if (ctx.arg.thinLTOModulesToCompile.empty()) {
     for (StringRef s : thinIndices) {
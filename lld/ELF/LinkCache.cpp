@@ -0,0 +1,274 @@
+//===- LinkCache.cpp ------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --link-cache-dir, which skips a link whose inputs and
+// options are identical to those of an earlier link. The cache uses the same
+// on-disk format as the ThinLTO cache (llvm/Support/Caching.h), so it can be
+// pruned with --link-cache-policy.
+//
+// On a cache hit, the output file is created as a hard link to the cache entry,
+// or as a copy if that fails (e.g. the cache is on another file system). lld
+// never modifies an existing output file in place except with --incremental,
+// which checks the link count of the file first.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LinkCache.h"
+#include "Config.h"
+#include "Driver.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Caching.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::sys;
+using namespace lld;
+using namespace lld::elf;
+
+// A cache hit skips the link, so options that make lld write anything other
+// than the output file, or that make the output differ from one link to the
+// next, cannot be used with the cache. Returns the name of such an option if
+// one is specified.
+static std::optional<StringRef>
+getUncacheableOption(Ctx &ctx, const opt::InputArgList &args) {
+  if (ctx.arg.outputFile == "-")
+    return "-o -";
+  if (ctx.tar)
+    return "--reproduce";
+  if (!ctx.arg.mapFile.empty())
+    return "-Map";
+  // Without -Map, the cross reference table is printed to stdout.
+  if (ctx.arg.cref)
+    return "--cref";
+  if (!ctx.arg.cmseOutputLib.empty())
+    return "--out-implib";
+  if (!ctx.arg.dependencyFile.empty())
+    return "--dependency-file";
+  if (!ctx.arg.whyExtract.empty())
+    return "--why-extract";
+  if (!ctx.arg.whyLive.empty())
+    return "--why-live";
+  if (!ctx.arg.printArchiveStats.empty())
+    return "--print-archive-stats";
+  if (!ctx.arg.printInputCosts.empty())
+    return "--print-input-costs";
+  if (!ctx.arg.printSymbolOrder.empty())
+    return "--print-symbol-order";
+  if (ctx.arg.printGcSections)
+    return "--print-gc-sections";
+  if (ctx.arg.printIcfSections)
+    return "--print-icf-sections";
+  if (ctx.arg.printMemoryUsage)
+    return "--print-memory-usage";
+  // A random build ID must differ from one link to the next.
+  if (ctx.arg.buildId == BuildIdKind::Uuid)
+    return "--build-id=uuid";
+  // A seed of 0 picks a different order on every link.
+  if (llvm::any_of(ctx.arg.shuffleSections,
+                   [](const auto &p) { return p.second == 0; }))
+    return "--shuffle-sections=<pattern>=0";
+  if (ctx.arg.trace)
+    return "--trace";
+  if (args.hasArg(OPT_trace_symbol))
+    return "--trace-symbol";
+  if (args.hasArg(OPT_save_temps, OPT_save_temps_eq))
+    return "--save-temps";
+  if (ctx.arg.ltoEmitAsm)
+    return "--lto-emit-asm";
+  if (ctx.arg.emitLLVM)
+    return "--plugin-opt=emit-llvm";
+  if (ctx.arg.thinLTOEmitIndexFiles || ctx.arg.thinLTOEmitImportsFiles)
+    return "--thinlto-index-only";
+  if (!ctx.arg.ltoObjPath.empty())
+    return "--lto-obj-path";
+  if (ctx.arg.ltoCSProfileGenerate)
+    return "--lto-cs-profile-generate";
+  if (!ctx.arg.optRemarksFilename.empty())
+    return "--opt-remarks-filename";
+  if (!ctx.arg.optStatsFilename.empty())
+    return "--plugin-opt=stats-file";
+  if (!ctx.arg.dwoDir.empty())
+    return "--plugin-opt=dwo_dir";
+  return std::nullopt;
+}
+
+LinkCache::LinkCache(Ctx &ctx, const opt::InputArgList &args) : ctx(ctx) {
+  if (std::optional<StringRef> opt = getUncacheableOption(ctx, args)) {
+    Log(ctx) << "--link-cache-dir: not using the cache because " << *opt
+             << " is specified";
+    return;
+  }
+
+  llvm::TimeTraceScope timeScope("Compute link cache key");
+
+  // Hash the contents of each file in parallel. This is the expensive part.
+  numBuffers = ctx.memoryBuffers.size();
+  SmallVector<uint64_t, 0> hashes(numBuffers);
+  parallelFor(0, numBuffers, [&](size_t i) {
+    hashes[i] = xxh3_64bits(ctx.memoryBuffers[i]->getBuffer());
+  });
+
+  std::string data;
+  raw_string_ostream os(data);
+  os << getLLDVersion() << '\0';
+
+  // The output path and the cache options do not affect the output.
+  for (const opt::Arg *arg : args) {
+    switch (arg->getOption().getID()) {
+    case OPT_o:
+    case OPT_link_cache_dir:
+    case OPT_link_cache_policy:
+      continue;
+    }
+    os << arg->getAsString(args) << '\0';
+  }
+
+  for (size_t i = 0; i != numBuffers; ++i)
+    os << ctx.memoryBuffers[i]->getBufferIdentifier() << '\0'
+       << format_hex(hashes[i], 18);
+
+  // Profiles are read by the LTO backend rather than by readFile().
+  for (StringRef path : {ctx.arg.ltoSampleProfile, ctx.arg.ltoCSProfileFile}) {
+    if (path.empty())
+      continue;
+    ErrorOr<std::unique_ptr<MemoryBuffer>> mb = MemoryBuffer::getFile(
+        path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!mb) {
+      Log(ctx) << "--link-cache-dir: not using the cache because " << path
+               << " cannot be read";
+      return;
+    }
+    os << path << '\0' << format_hex(xxh3_64bits((*mb)->getBuffer()), 18);
+  }
+
+  XXH128_hash_t hash = xxh3_128bits(arrayRefFromStringRef(data));
+  key = (utohexstr(hash.high64, /*LowerCase=*/true, /*Width=*/16) +
+         utohexstr(hash.low64, /*LowerCase=*/true, /*Width=*/16));
+}
+
+// Sets the modification time of the output to the current time. Otherwise, a
+// hard link would keep the time of the earlier link, and build systems would
+// consider the output to be out of date.
+static void touch(StringRef path) {
+  int fd;
+  if (fs::openFileForReadWrite(path, fd, fs::CD_OpenExisting, fs::OF_None))
+    return;
+  (void)fs::setLastAccessAndModificationTime(fd,
+                                             std::chrono::system_clock::now());
+  Process::SafelyCloseFileDescriptor(fd);
+}
+
+bool LinkCache::restore() {
+  if (key.empty())
+    return false;
+  llvm::TimeTraceScope timeScope("Look up link cache");
+
+  // The callback is also called when save() commits a new entry.
+  Expected<FileCache> cache = localCache(
+      "--link-cache-dir", "lld", ctx.arg.linkCacheDir,
+      [this](unsigned, const Twine &, std::unique_ptr<MemoryBuffer> mb) {
+        entry = std::move(mb);
+      });
+  if (!cache) {
+    Warn(ctx) << "--link-cache-dir: " << cache.takeError();
+    key.clear();
+    return false;
+  }
+  Expected<AddStreamFn> addStreamOrErr = (*cache)(0, key, ctx.arg.outputFile);
+  if (!addStreamOrErr) {
+    Warn(ctx) << "--link-cache-dir: " << addStreamOrErr.takeError();
+    key.clear();
+    return false;
+  }
+  if (*addStreamOrErr) {
+    addStream = std::move(*addStreamOrErr);
+    return false;
+  }
+
+  StringRef entryPath = entry->getBufferIdentifier();
+  Log(ctx) << "--link-cache-dir: using " << entryPath;
+  (void)fs::remove(ctx.arg.outputFile);
+  if (fs::create_hard_link(entryPath, ctx.arg.outputFile)) {
+    Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+        FileOutputBuffer::create(ctx.arg.outputFile, entry->getBufferSize(),
+                                 ctx.arg.relocatable
+                                     ? 0
+                                     : FileOutputBuffer::F_executable);
+    if (!bufferOrErr) {
+      Warn(ctx) << "--link-cache-dir: cannot create " << ctx.arg.outputFile
+                << ": " << bufferOrErr.takeError();
+      return false;
+    }
+    std::unique_ptr<FileOutputBuffer> &buffer = *bufferOrErr;
+    memcpy(buffer->getBufferStart(), entry->getBufferStart(),
+           entry->getBufferSize());
+    if (Error e = buffer->commit()) {
+      Warn(ctx) << "--link-cache-dir: cannot create " << ctx.arg.outputFile
+                << ": " << std::move(e);
+      return false;
+    }
+  }
+  touch(ctx.arg.outputFile);
+  return true;
+}
+
+void LinkCache::save() {
+  if (!addStream || errCount(ctx) || ctx.e.disableOutput)
+    return;
+  // A cache hit would not report the warnings again.
+  if (ctx.e.warningCount) {
+    Log(ctx) << "--link-cache-dir: not caching the output because warnings "
+                "were reported";
+    return;
+  }
+  if (ctx.memoryBuffers.size() != numBuffers) {
+    Log(ctx) << "--link-cache-dir: not caching the output because "
+             << ctx.memoryBuffers[numBuffers]->getBufferIdentifier()
+             << " was read during the link";
+    return;
+  }
+  llvm::TimeTraceScope timeScope("Update link cache");
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mb =
+      MemoryBuffer::getFile(ctx.arg.outputFile, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (!mb) {
+    Warn(ctx) << "--link-cache-dir: cannot read " << ctx.arg.outputFile << ": "
+              << mb.getError().message();
+    return;
+  }
+
+  Expected<std::unique_ptr<CachedFileStream>> streamOrErr =
+      addStream(0, ctx.arg.outputFile);
+  if (!streamOrErr) {
+    Warn(ctx) << "--link-cache-dir: " << streamOrErr.takeError();
+    return;
+  }
+  *(*streamOrErr)->OS << (*mb)->getBuffer();
+  if (Error e = (*streamOrErr)->commit()) {
+    Warn(ctx) << "--link-cache-dir: " << std::move(e);
+    return;
+  }
+
+  // Outputs restored by hard links share the permissions of the entry.
+  fs::file_status st;
+  if (entry && !fs::status(ctx.arg.outputFile, st))
+    (void)fs::setPermissions(entry->getBufferIdentifier(), st.permissions());
+
+  pruneCache(ctx.arg.linkCacheDir, ctx.arg.linkCachePolicy);
+}
@@ -0,0 +1,59 @@
+//===- LinkCache.h ----------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_LINK_CACHE_H
+#define LLD_ELF_LINK_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/Caching.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+
+namespace llvm::opt {
+class InputArgList;
+}
+
+namespace lld::elf {
+struct Ctx;
+
+// Implements --link-cache-dir. The cache key is a hash of the lld version, the
+// command line and the contents of all files read before symbol resolution
+// (input files, archives, linker scripts, version scripts, etc.). If an entry
+// for the key exists, the output is created from it without linking.
+// Otherwise, the output is added to the cache after a successful link.
+class LinkCache {
+public:
+  // Computes the cache key. Must be called after all input files have been
+  // read.
+  LinkCache(Ctx &ctx, const llvm::opt::InputArgList &args);
+
+  // Creates the output file from the cache. Returns false on a cache miss.
+  bool restore();
+
+  // Adds the output file of the finished link to the cache after a miss in
+  // restore(). The cost recorded for the entry is the time since that miss.
+  void save();
+
+private:
+  Ctx &ctx;
+  // Empty if this link must not use the cache.
+  std::string key;
+  // The number of files read when the key was computed. If a file is read
+  // later (e.g. via .deplibs), the key does not cover it.
+  size_t numBuffers = 0;
+  // Set by restore() on a miss. Its timer starts at the lookup, so the entry
+  // written by save() records the time taken by the link.
+  llvm::AddStreamFn addStream;
+  // The cache entry found by restore(), or the one added by save().
+  std::unique_ptr<llvm::MemoryBuffer> entry;
+};
+
+} // namespace lld::elf
+
+#endif
@@ -1264,6 +1264,13 @@ bool LinkerScript::assignOffsets(OutputSection *sec) {
       isec->outSecOff = dot - sec->addr;
       dot += isec->getSize();
 
+      // With --incremental-padding, reserve room after each executable input
+      // section so that a later --incremental link can grow it without moving
+      // the sections that follow. The gap is filled with trap instructions.
+      if (ctx.arg.incrementalPadding && (sec->flags & SHF_EXECINSTR) &&
+          isec->kind() == SectionBase::Regular)
+        dot = alignToPowerOf2(dot, ctx.arg.incrementalPadding);
+
       // Update output section size after adding each section. This is so that
       // SIZEOF works correctly in the case below:
       // .foo { *(.aaa) a = SIZEOF(.foo); *(.bbb) }
@@ -17,6 +17,10 @@
 // bits. Writer will then ignore sections whose Live bits are off, so that
 // such sections are not included into output.
 //
+// In the common case of a single partition without --why-live, the graph is
+// traversed in breadth-first order, and the sections of each level are
+// scanned in parallel. See markParallel().
+//
 //===----------------------------------------------------------------------===//
 
 #include "MarkLive.h"
@@ -30,6 +34,7 @@
 #include "lld/Common/Strings.h"
 #include "llvm/ADT/DenseMapInfoVariant.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/TimeProfiler.h"
 #include <variant>
 #include <vector>
@@ -66,10 +71,36 @@ private:
                LiveReason reason);
   void markSymbol(Symbol *sym, StringRef reason);
   void mark();
+  void markParallel();
 
   template <class RelTy>
   void resolveReloc(InputSectionBase &sec, RelTy &rel, bool fromFDE);
 
+  // State changes found by scanning sections in parallel. They are applied
+  // serially by markParallel().
+  struct ScanResult {
+    // Symbols to be marked as used.
+    SmallVector<Symbol *, 0> syms;
+    // Pieces of mergeable sections to be marked as live.
+    SmallVector<SectionPiece *, 0> pieces;
+    // Sections to be marked as live.
+    SmallVector<InputSectionBase *, 0> secs;
+
+    // Records what enqueue(sec, offset) would change.
+    void addSection(InputSectionBase *sec, uint64_t offset) {
+      if (auto *ms = dyn_cast<MergeInputSection>(sec)) {
+        SectionPiece &piece = ms->getSectionPiece(offset);
+        if (!piece.live)
+          pieces.push_back(&piece);
+      }
+      if (!sec->isLive())
+        secs.push_back(sec);
+    }
+  };
+
+  template <class RelTy>
+  void scanReloc(InputSectionBase &sec, const RelTy &rel, ScanResult &res);
+
   template <class RelTy>
   void scanEhFrameSection(EhInputSection &eh, ArrayRef<RelTy> rels);
 
@@ -171,6 +202,41 @@ void MarkLive<ELFT, TrackWhyLive>::resolveReloc(InputSectionBase &sec,
     enqueue(sec, /*offset=*/0, /*sym=*/nullptr, reason);
 }
 
+// A thread-safe counterpart of resolveReloc (with fromFDE == false) used by
+// markParallel(). Instead of changing any state, it records the changes that
+// resolveReloc would make. Changes that have already been made are skipped to
+// keep the serial part small.
+template <class ELFT, bool TrackWhyLive>
+template <class RelTy>
+void MarkLive<ELFT, TrackWhyLive>::scanReloc(InputSectionBase &sec,
+                                             const RelTy &rel,
+                                             ScanResult &res) {
+  Symbol &sym = sec.file->getRelocTargetSym(rel);
+
+  if (auto *d = dyn_cast<Defined>(&sym)) {
+    if (!sym.used)
+      res.syms.push_back(&sym);
+    auto *relSec = dyn_cast_or_null<InputSectionBase>(d->section);
+    if (!relSec)
+      return;
+    uint64_t offset = d->value;
+    if (d->isSection())
+      offset += getAddend<ELFT>(ctx, sec, rel);
+    res.addSection(relSec, offset);
+    return;
+  }
+
+  auto *ss = dyn_cast<SharedSymbol>(&sym);
+  if (!sym.used || (ss && !ss->isWeak() &&
+                    !cast<SharedFile>(ss->file)->isNeeded))
+    res.syms.push_back(&sym);
+
+  auto it = cNamedSections.find(sym.getName());
+  if (it != cNamedSections.end())
+    for (InputSectionBase *isec : it->second)
+      res.addSection(isec, /*offset=*/0);
+}
+
 // The .eh_frame section is an unfortunate special case.
 // The section is divided in CIEs and FDEs and the relocations it can have are
 // * CIEs can refer to a personality function.
@@ -444,6 +510,12 @@ void MarkLive<ELFT, TrackWhyLive>::run() {
 
 template <class ELFT, bool TrackWhyLive>
 void MarkLive<ELFT, TrackWhyLive>::mark() {
+  if (!TrackWhyLive && ctx.partitions.size() == 1 &&
+      parallel::strategy.ThreadsRequested != 1) {
+    markParallel();
+    return;
+  }
+
   // Mark all reachable sections.
   while (!queue.empty()) {
     InputSectionBase &sec = *queue.pop_back_val();
@@ -467,6 +539,65 @@ void MarkLive<ELFT, TrackWhyLive>::mark() {
   }
 }
 
+// Marks all sections reachable from the queue, like mark(). This is only used
+// with a single partition, where the state of a section is just a live bit,
+// and without --why-live, which depends on the visiting order.
+//
+// Sections are visited one level at a time. The relocations of the sections
+// in a level are scanned in parallel without changing any state, and the
+// results are applied serially in order. Newly marked sections form the next
+// level. Since nothing is modified while scanning, threads never race, and the
+// result is the same as that of mark().
+template <class ELFT, bool TrackWhyLive>
+void MarkLive<ELFT, TrackWhyLive>::markParallel() {
+  const size_t chunkSize = 64;
+  SmallVector<InputSection *, 0> level;
+  SmallVector<ScanResult, 0> results;
+  while (!queue.empty()) {
+    std::swap(level, queue);
+    queue.clear();
+    results.clear();
+    results.resize(divideCeil(level.size(), chunkSize));
+
+    parallelFor(0, results.size(), [&](size_t i) {
+      ScanResult &res = results[i];
+      for (InputSection *sec :
+           ArrayRef(level).slice(i * chunkSize).take_front(chunkSize)) {
+        const RelsOrRelas<ELFT> rels = sec->template relsOrRelas<ELFT>();
+        for (const typename ELFT::Rel &rel : rels.rels)
+          scanReloc(*sec, rel, res);
+        for (const typename ELFT::Rela &rel : rels.relas)
+          scanReloc(*sec, rel, res);
+        for (const typename ELFT::Crel &rel : rels.crels)
+          scanReloc(*sec, rel, res);
+
+        for (InputSectionBase *isec : sec->dependentSections)
+          res.addSection(isec, /*offset=*/0);
+        if (sec->nextInSectionGroup)
+          res.addSection(sec->nextInSectionGroup, /*offset=*/0);
+      }
+    });
+
+    for (ScanResult &res : results) {
+      for (Symbol *sym : res.syms) {
+        sym->used = true;
+        if (auto *ss = dyn_cast<SharedSymbol>(sym))
+          if (!ss->isWeak())
+            cast<SharedFile>(ss->file)->isNeeded = true;
+      }
+      for (SectionPiece *piece : res.pieces)
+        piece->live = true;
+      for (InputSectionBase *sec : res.secs) {
+        if (sec->isLive())
+          continue;
+        sec->markLive();
+        if (auto *s = dyn_cast<InputSection>(sec))
+          queue.push_back(s);
+      }
+    }
+  }
+}
+
 // Move the sections for some symbols to the main partition, specifically ifuncs
 // (because they can result in an IRELATIVE being added to the main partition's
 // GOT, which means that the ifunc must be available when the main partition is
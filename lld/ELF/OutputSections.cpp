@@ -328,6 +328,48 @@ static void fill(uint8_t *buf, size_t size,
   memcpy(buf + i, filler.data(), size - i);
 }
 
+// Writes an input section to loc and attributes the cost to the file that
+// defines the section.
+template <class ELFT>
+static void writeInputSection(Ctx &ctx, InputSection *isec, uint8_t *loc) {
+  InputCostScope costScope(ctx, isec->file, InputCost::Write);
+  if (auto *s = dyn_cast<SyntheticSection>(isec))
+    s->writeTo(loc);
+  else
+    isec->writeTo<ELFT>(ctx, loc);
+  if (isec->file && !ctx.arg.printInputCosts.empty())
+    isec->file->cost.outputBytes += isec->getSize();
+}
+
+#if LLVM_ENABLE_ZSTD
+// Use ZSTD's streaming compression API. See
+// http://facebook.github.io/zstd/zstd_manual.html "Streaming compression -
+// HowTo".
+static SmallVector<uint8_t, 0> compressZstdShard(ArrayRef<uint8_t> in,
+                                                 int level) {
+  SmallVector<uint8_t, 0> out;
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+  ZSTD_inBuffer zib = {in.data(), in.size(), 0};
+  ZSTD_outBuffer zob = {nullptr, 0, 0};
+  size_t size;
+  do {
+    // Allocate a buffer of half of the input size, and grow it by 1.5x if
+    // insufficient.
+    if (zob.pos == zob.size) {
+      out.resize_for_overwrite(
+          zob.size ? zob.size * 3 / 2 : std::max<size_t>(zib.size / 4, 64));
+      zob = {out.data(), out.size(), zob.pos};
+    }
+    size = ZSTD_compressStream2(cctx, &zob, &zib, ZSTD_e_end);
+    assert(!ZSTD_isError(size));
+  } while (size != 0);
+  out.truncate(zob.pos);
+  ZSTD_freeCCtx(cctx);
+  return out;
+}
+#endif
+
 #if LLVM_ENABLE_ZLIB
 static SmallVector<uint8_t, 0> deflateShard(Ctx &ctx, ArrayRef<uint8_t> in,
                                             int level, int flush) {
@@ -389,12 +431,7 @@ template <class ELFT> void OutputSection::maybeCompress(Ctx &ctx) {
   }
 
   llvm::TimeTraceScope timeScope("Compress sections");
-  auto buf = std::make_unique<uint8_t[]>(size);
-  // Write uncompressed data to a temporary zero-initialized buffer.
-  {
-    parallel::TaskGroup tg;
-    writeTo<ELFT>(ctx, buf.get(), tg);
-  }
+
   // The generic ABI specifies "The sh_size and sh_addralign fields of the
   // section header for a compressed section reflect the requirements of the
   // compressed section." However, 1-byte alignment has been wildly accepted
@@ -402,69 +439,147 @@ template <class ELFT> void OutputSection::maybeCompress(Ctx &ctx) {
   // useful when there are many compressed output sections.
   addralign = 1;
 
-  // Split input into 1-MiB shards.
-  [[maybe_unused]] constexpr size_t shardSize = 1 << 20;
-  auto shardsIn = split(ArrayRef<uint8_t>(buf.get(), size), shardSize);
-  const size_t numShards = shardsIn.size();
-  auto shardsOut = std::make_unique<SmallVector<uint8_t, 0>[]>(numShards);
+  // The section is compressed in independent shards of about 1 MiB, which are
+  // concatenated. Shards do not need to have the same size.
+  constexpr size_t shardSize = 1 << 20;
+
+  // Input sections are written to temporary buffers in groups of consecutive
+  // sections of about shardSize bytes, and each group is compressed as one
+  // shard as soon as it has been written. This keeps at most one group per
+  // thread in memory instead of the whole uncompressed section. A section
+  // larger than shardSize forms a group of its own, which is written first
+  // and then compressed in shardSize pieces in parallel.
+  //
+  // Linker script data commands, non-zero fillers and CREL are rare. For such
+  // sections, the whole section is written to a single buffer.
+  SmallVector<InputSection *, 0> storage;
+  ArrayRef<InputSection *> sections = getInputSections(*this, storage);
+  bool streaming = !sections.empty() && type != SHT_CREL &&
+                   !(flags & SHF_EXECINSTR) &&
+                   read32(ctx, getFiller(ctx).data()) == 0 &&
+                   llvm::none_of(commands, [](SectionCommand *cmd) {
+                     return isa<ByteCommand>(cmd);
+                   });
+
+  struct Group {
+    // The range of input sections and the range of the uncompressed section
+    // covered by this group.
+    size_t begin, end;
+    uint64_t offset, size;
+    // If true, this group is compressed in shardSize pieces.
+    bool large;
+    size_t firstShard = 0;
+  };
+  SmallVector<Group, 0> groups;
+  if (streaming) {
+    for (size_t i = 0, n = sections.size(); i != n;) {
+      size_t begin = i;
+      uint64_t offset = groups.empty() ? 0 : sections[i]->outSecOff;
+      bool large = sections[i]->getSize() >= shardSize;
+      if (large) {
+        ++i;
+      } else {
+        do {
+          ++i;
+        } while (i != n && sections[i]->getSize() < shardSize &&
+                 sections[i]->outSecOff - offset < shardSize);
+      }
+      uint64_t end = i == n ? size : sections[i]->outSecOff;
+      groups.push_back({begin, i, offset, end - offset, large});
+    }
+  } else {
+    groups.push_back({0, sections.size(), 0, size, /*large=*/true});
+  }
 
-#if LLVM_ENABLE_ZSTD
-  // Use ZSTD's streaming compression API. See
-  // http://facebook.github.io/zstd/zstd_manual.html "Streaming compression -
-  // HowTo".
-  if (ctype == DebugCompressionType::Zstd) {
-    parallelFor(0, numShards, [&](size_t i) {
-      SmallVector<uint8_t, 0> out;
-      ZSTD_CCtx *cctx = ZSTD_createCCtx();
-      ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
-      ZSTD_inBuffer zib = {shardsIn[i].data(), shardsIn[i].size(), 0};
-      ZSTD_outBuffer zob = {nullptr, 0, 0};
-      size_t size;
-      do {
-        // Allocate a buffer of half of the input size, and grow it by 1.5x if
-        // insufficient.
-        if (zob.pos == zob.size) {
-          out.resize_for_overwrite(
-              zob.size ? zob.size * 3 / 2 : std::max<size_t>(zib.size / 4, 64));
-          zob = {out.data(), out.size(), zob.pos};
-        }
-        size = ZSTD_compressStream2(cctx, &zob, &zib, ZSTD_e_end);
-        assert(!ZSTD_isError(size));
-      } while (size != 0);
-      out.truncate(zob.pos);
-      ZSTD_freeCCtx(cctx);
-      shardsOut[i] = std::move(out);
-    });
-    compressed.type = ELFCOMPRESS_ZSTD;
-    for (size_t i = 0; i != numShards; ++i)
-      compressedSize += shardsOut[i].size();
+  // Assign shards to groups and record their uncompressed sizes.
+  SmallVector<uint64_t, 0> shardsInSize;
+  for (Group &g : groups) {
+    g.firstShard = shardsInSize.size();
+    if (!g.large)
+      shardsInSize.push_back(g.size);
+    else
+      for (uint64_t off = 0; off < g.size; off += shardSize)
+        shardsInSize.push_back(std::min<uint64_t>(shardSize, g.size - off));
   }
-#endif
+  const size_t numShards = shardsInSize.size();
+  auto shardsOut = std::make_unique<SmallVector<uint8_t, 0>[]>(numShards);
+  [[maybe_unused]] auto shardsAdler = std::make_unique<uint32_t[]>(numShards);
 
+  // We chose 1 (Z_BEST_SPEED) as the default compression level for zlib
+  // because it is fast and provides decent compression ratios.
 #if LLVM_ENABLE_ZLIB
-  // We chose 1 (Z_BEST_SPEED) as the default compression level because it is
-  // fast and provides decent compression ratios.
-  if (ctype == DebugCompressionType::Zlib) {
-    if (!level)
-      level = Z_BEST_SPEED;
+  if (ctype == DebugCompressionType::Zlib && !level)
+    level = Z_BEST_SPEED;
+#endif
 
+  auto compressShard = [&](size_t i, ArrayRef<uint8_t> in) {
+#if LLVM_ENABLE_ZSTD
+    if (ctype == DebugCompressionType::Zstd)
+      shardsOut[i] = compressZstdShard(in, level);
+#endif
+#if LLVM_ENABLE_ZLIB
     // Compress shards and compute Alder-32 checksums. Use Z_SYNC_FLUSH for all
     // shards but the last to flush the output to a byte boundary to be
     // concatenated with the next shard.
-    auto shardsAdler = std::make_unique<uint32_t[]>(numShards);
-    parallelFor(0, numShards, [&](size_t i) {
-      shardsOut[i] = deflateShard(ctx, shardsIn[i], level,
+    if (ctype == DebugCompressionType::Zlib) {
+      shardsOut[i] = deflateShard(ctx, in, level,
                                   i != numShards - 1 ? Z_SYNC_FLUSH : Z_FINISH);
-      shardsAdler[i] = adler32(1, shardsIn[i].data(), shardsIn[i].size());
+      shardsAdler[i] = adler32(1, in.data(), in.size());
+    }
+#endif
+  };
+
+  // Writes the input sections of a group to a zero-initialized buffer.
+  auto writeGroup = [&](const Group &g) {
+    auto buf = std::make_unique<uint8_t[]>(g.size);
+    if (!streaming) {
+      parallel::TaskGroup tg;
+      writeTo<ELFT>(ctx, buf.get(), tg);
+      return buf;
+    }
+    for (size_t i = g.begin; i != g.end; ++i) {
+      InputSection *isec = sections[i];
+      writeInputSection<ELFT>(ctx, isec,
+                              buf.get() + (isec->outSecOff - g.offset));
+    }
+    return buf;
+  };
+
+  // Write and compress groups of small sections, one task per group.
+  parallelFor(0, groups.size(), [&](size_t i) {
+    if (groups[i].large)
+      return;
+    std::unique_ptr<uint8_t[]> buf = writeGroup(groups[i]);
+    compressShard(groups[i].firstShard,
+                  ArrayRef<uint8_t>(buf.get(), groups[i].size));
+  });
+
+  // Write large sections one at a time and compress their pieces in parallel.
+  for (const Group &g : groups) {
+    if (!g.large)
+      continue;
+    std::unique_ptr<uint8_t[]> buf = writeGroup(g);
+    auto shardsIn = split(ArrayRef<uint8_t>(buf.get(), g.size), shardSize);
+    parallelFor(0, shardsIn.size(), [&](size_t i) {
+      compressShard(g.firstShard + i, shardsIn[i]);
     });
+  }
 
+  for (size_t i = 0; i != numShards; ++i)
+    compressedSize += shardsOut[i].size();
+
+#if LLVM_ENABLE_ZSTD
+  if (ctype == DebugCompressionType::Zstd)
+    compressed.type = ELFCOMPRESS_ZSTD;
+#endif
+
+#if LLVM_ENABLE_ZLIB
+  if (ctype == DebugCompressionType::Zlib) {
     // Update section size and combine Alder-32 checksums.
-    uint32_t checksum = 1;       // Initial Adler-32 value
-    compressedSize += 2;         // Elf_Chdir and zlib header
-    for (size_t i = 0; i != numShards; ++i) {
-      compressedSize += shardsOut[i].size();
-      checksum = adler32_combine(checksum, shardsAdler[i], shardsIn[i].size());
-    }
+    uint32_t checksum = 1; // Initial Adler-32 value
+    compressedSize += 2;   // zlib header
+    for (size_t i = 0; i != numShards; ++i)
+      checksum = adler32_combine(checksum, shardsAdler[i], shardsInSize[i]);
     compressedSize += 4; // checksum
     compressed.type = ELFCOMPRESS_ZLIB;
     compressed.checksum = checksum;
@@ -494,7 +609,8 @@ static void writeInt(Ctx &ctx, uint8_t *buf, uint64_t data, uint64_t size) {
 }
 
 template <class ELFT>
-void OutputSection::writeTo(Ctx &ctx, uint8_t *buf, parallel::TaskGroup &tg) {
+void OutputSection::writeTo(Ctx &ctx, uint8_t *buf, parallel::TaskGroup &tg,
+                            const BitVector *dirty) {
   llvm::TimeTraceScope timeScope("Write sections", name);
   if (type == SHT_NOBITS)
     return;
@@ -535,7 +651,12 @@ void OutputSection::writeTo(Ctx &ctx, uint8_t *buf, parallel::TaskGroup &tg) {
   ArrayRef<InputSection *> sections = getInputSections(*this, storage);
   std::array<uint8_t, 4> filler = getFiller(ctx);
   bool nonZeroFiller = read32(ctx, filler.data()) != 0;
-  if (nonZeroFiller)
+  // When updating an existing file, gaps may hold stale bytes and have to be
+  // filled even if the filler is zero. This includes the gaps next to input
+  // sections that are not rewritten, since a gap also changes when only the
+  // alignment of the following section does.
+  bool fillGaps = nonZeroFiller || dirty;
+  if (fillGaps)
     fill(buf, sections.empty() ? size : sections[0]->outSecOff, filler);
 
   if (type == SHT_CREL && !(flags & SHF_ALLOC)) {
@@ -548,19 +669,18 @@ void OutputSection::writeTo(Ctx &ctx, uint8_t *buf, parallel::TaskGroup &tg) {
     size_t numSections = sections.size();
     for (size_t i = begin; i != end; ++i) {
       InputSection *isec = sections[i];
-      if (auto *s = dyn_cast<SyntheticSection>(isec))
-        s->writeTo(buf + isec->outSecOff);
-      else
-        isec->writeTo<ELFT>(ctx, buf + isec->outSecOff);
-
-      // When in Arm BE8 mode, the linker has to convert the big-endian
-      // instructions to little-endian, leaving the data big-endian.
-      if (ctx.arg.emachine == EM_ARM && !ctx.arg.isLE && ctx.arg.armBe8 &&
-          (flags & SHF_EXECINSTR))
-        convertArmInstructionstoBE8(ctx, isec, buf + isec->outSecOff);
+      if (!dirty || dirty->test(i)) {
+        writeInputSection<ELFT>(ctx, isec, buf + isec->outSecOff);
+
+        // When in Arm BE8 mode, the linker has to convert the big-endian
+        // instructions to little-endian, leaving the data big-endian.
+        if (ctx.arg.emachine == EM_ARM && !ctx.arg.isLE && ctx.arg.armBe8 &&
+            (flags & SHF_EXECINSTR))
+          convertArmInstructionstoBE8(ctx, isec, buf + isec->outSecOff);
+      }
 
       // Fill gaps between sections.
-      if (nonZeroFiller) {
+      if (fillGaps) {
         uint8_t *start = buf + isec->outSecOff + isec->getSize();
         uint8_t *end;
         if (i + 1 == numSections)
@@ -945,13 +1065,17 @@ template void OutputSection::writeHeaderTo<ELF64LE>(ELF64LE::Shdr *Shdr);
 template void OutputSection::writeHeaderTo<ELF64BE>(ELF64BE::Shdr *Shdr);
 
 template void OutputSection::writeTo<ELF32LE>(Ctx &, uint8_t *,
-                                              llvm::parallel::TaskGroup &);
+                                              llvm::parallel::TaskGroup &,
+                                              const BitVector *);
 template void OutputSection::writeTo<ELF32BE>(Ctx &, uint8_t *,
-                                              llvm::parallel::TaskGroup &);
+                                              llvm::parallel::TaskGroup &,
+                                              const BitVector *);
 template void OutputSection::writeTo<ELF64LE>(Ctx &, uint8_t *,
-                                              llvm::parallel::TaskGroup &);
+                                              llvm::parallel::TaskGroup &,
+                                              const BitVector *);
 template void OutputSection::writeTo<ELF64BE>(Ctx &, uint8_t *,
-                                              llvm::parallel::TaskGroup &);
+                                              llvm::parallel::TaskGroup &,
+                                              const BitVector *);
 
 template void OutputSection::maybeCompress<ELF32LE>(Ctx &);
 template void OutputSection::maybeCompress<ELF32BE>(Ctx &);
@@ -12,6 +12,7 @@
 #include "InputSection.h"
 #include "LinkerScript.h"
 #include "lld/Common/LLVM.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Parallel.h"
 
@@ -115,8 +116,11 @@ public:
 
   template <bool is64> void finalizeNonAllocCrel(Ctx &);
   void finalize(Ctx &);
+  // If `dirty` is non-null, only the input sections whose bits are set are
+  // written. This is used by --incremental to update an existing output file.
   template <class ELFT>
-  void writeTo(Ctx &, uint8_t *buf, llvm::parallel::TaskGroup &tg);
+  void writeTo(Ctx &, uint8_t *buf, llvm::parallel::TaskGroup &tg,
+               const llvm::BitVector *dirty = nullptr);
   // Check that the addends for dynamic relocations were written correctly.
   void checkDynRelAddends(Ctx &);
   template <class ELFT> void maybeCompress(Ctx &);
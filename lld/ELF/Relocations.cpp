@@ -880,6 +880,43 @@ static void addRelativeReloc(Ctx &ctx, InputSectionBase &isec,
                                         offsetInSec, sym, addend, type, expr);
 }
 
+// Add a dynamic relocation of type `rel` against a possibly preemptible
+// symbol. If `shard` is true, this may be called concurrently.
+template <bool shard>
+static void addSymbolicReloc(Ctx &ctx, InputSectionBase &isec,
+                             uint64_t offsetInSec, Symbol &sym, int64_t addend,
+                             RelExpr expr, RelType type, RelType rel) {
+  Partition &part = isec.getPartition(ctx);
+  if (ctx.arg.emachine == EM_AARCH64 && type == R_AARCH64_AUTH_ABS64) {
+    // For a preemptible symbol, we can't use a relative relocation. For an
+    // undefined symbol, we can't compute offset at link-time and use a
+    // relative relocation. Use a symbolic relocation instead.
+    if (sym.isPreemptible) {
+      part.relaDyn->addSymbolReloc<shard>(type, isec, offsetInSec, sym, addend,
+                                          type);
+    } else if (part.relrAuthDyn && isec.addralign >= 2 &&
+               offsetInSec % 2 == 0) {
+      // When symbol values are determined in
+      // finalizeAddressDependentContent, some .relr.auth.dyn relocations
+      // may be moved to .rela.dyn.
+      isec.addReloc({expr, type, offsetInSec, addend, &sym});
+      if (shard)
+        part.relrAuthDyn->relocsVec[parallel::getThreadIndex()].push_back(
+            {&isec, isec.relocs().size() - 1});
+      else
+        part.relrAuthDyn->relocs.push_back({&isec, isec.relocs().size() - 1});
+    } else {
+      part.relaDyn->addReloc<shard>({R_AARCH64_AUTH_RELATIVE, &isec,
+                                     offsetInSec,
+                                     DynamicReloc::AddendOnlyWithTargetVA, sym,
+                                     addend, R_ABS});
+    }
+    return;
+  }
+  part.relaDyn->addSymbolReloc<shard>(rel, isec, offsetInSec, sym, addend,
+                                      type);
+}
+
 template <class PltSection, class GotPltSection>
 static void addPltEntry(Ctx &ctx, PltSection &plt, GotPltSection &gotPlt,
                         RelocationBaseSection &rel, RelType type, Symbol &sym) {
@@ -1144,28 +1181,17 @@ void RelocationScanner::processAux(RelExpr expr, RelType type, uint64_t offset,
     if (rel != 0) {
       if (ctx.arg.emachine == EM_MIPS && rel == ctx.target->symbolicRel)
         rel = ctx.target->relativeRel;
-      std::lock_guard<std::mutex> lock(ctx.relocMutex);
-      Partition &part = sec->getPartition(ctx);
-      if (ctx.arg.emachine == EM_AARCH64 && type == R_AARCH64_AUTH_ABS64) {
-        // For a preemptible symbol, we can't use a relative relocation. For an
-        // undefined symbol, we can't compute offset at link-time and use a
-        // relative relocation. Use a symbolic relocation instead.
-        if (sym.isPreemptible) {
-          part.relaDyn->addSymbolReloc(type, *sec, offset, sym, addend, type);
-        } else if (part.relrAuthDyn && sec->addralign >= 2 && offset % 2 == 0) {
-          // When symbol values are determined in
-          // finalizeAddressDependentContent, some .relr.auth.dyn relocations
-          // may be moved to .rela.dyn.
-          sec->addReloc({expr, type, offset, addend, &sym});
-          part.relrAuthDyn->relocs.push_back({sec, sec->relocs().size() - 1});
-        } else {
-          part.relaDyn->addReloc({R_AARCH64_AUTH_RELATIVE, sec, offset,
-                                  DynamicReloc::AddendOnlyWithTargetVA, sym,
-                                  addend, R_ABS});
-        }
+      // With -z combreloc, computeRels() sorts the dynamic relocations, so
+      // they can be collected in per-thread buffers without making the output
+      // depend on thread scheduling. Otherwise, scanning is serial and the
+      // relocations are added in order.
+      if (ctx.arg.zCombreloc)
+        addSymbolicReloc<true>(ctx, *sec, offset, sym, addend, expr, type, rel);
+      else
+        addSymbolicReloc<false>(ctx, *sec, offset, sym, addend, expr, type,
+                                rel);
+      if (ctx.arg.emachine == EM_AARCH64 && type == R_AARCH64_AUTH_ABS64)
         return;
-      }
-      part.relaDyn->addSymbolReloc(rel, *sec, offset, sym, addend, type);
 
       // MIPS ABI turns using of GOT and dynamic relocations inside out.
       // While regular ABI uses dynamic relocations to fill up GOT entries
@@ -1709,6 +1735,7 @@ template <class ELFT> void elf::scanRelocations(Ctx &ctx) {
   auto outerFn = [&]() {
     for (ELFFileBase *f : ctx.objectFiles) {
       auto fn = [f, &ctx]() {
+        InputCostScope costScope(ctx, f, InputCost::ScanRelocs);
         RelocationScanner scanner(ctx);
         for (InputSectionBase *s : f->getSections()) {
           if (s && s->kind() == SectionBase::Regular && s->isLive() &&
@@ -1956,14 +1983,39 @@ void elf::postScanRelocations(Ctx &ctx) {
                         got->getTlsIndexOff(), 1, &dummy});
   }
 
+  // Most symbols need no work here. Find the ones that may in parallel, then
+  // process them serially in the original order so that GOT/PLT entry indices
+  // do not depend on the number of threads. fn may only clear the flags of
+  // symbols it has not visited yet (copy relocation aliases), so filtering
+  // upfront does not change the result.
+  auto mayNeedWork = [](const Symbol &sym) {
+    return sym.needsDynReloc() || sym.isGnuIFunc() || sym.isTagged();
+  };
+  ArrayRef<Symbol *> syms = ctx.symtab->getSymbols();
+  const size_t chunkSize = 4096;
+  SmallVector<SmallVector<Symbol *, 0>, 0> globals(
+      divideCeil(syms.size(), chunkSize));
+  parallelFor(0, globals.size(), [&](size_t i) {
+    for (Symbol *sym : syms.slice(i * chunkSize).take_front(chunkSize))
+      if (mayNeedWork(*sym))
+        globals[i].push_back(sym);
+  });
+  SmallVector<SmallVector<Symbol *, 0>, 0> locals(ctx.objectFiles.size());
+  parallelFor(0, locals.size(), [&](size_t i) {
+    for (Symbol *sym : ctx.objectFiles[i]->getLocalSymbols())
+      if (mayNeedWork(*sym))
+        locals[i].push_back(sym);
+  });
+
   assert(ctx.symAux.size() == 1);
-  for (Symbol *sym : ctx.symtab->getSymbols())
-    fn(*sym);
+  for (ArrayRef<Symbol *> chunk : globals)
+    for (Symbol *sym : chunk)
+      fn(*sym);
 
   // Local symbols may need the aforementioned non-preemptible ifunc and GOT
   // handling. They don't need regular PLT.
-  for (ELFFileBase *file : ctx.objectFiles)
-    for (Symbol *sym : file->getLocalSymbols())
+  for (ArrayRef<Symbol *> chunk : locals)
+    for (Symbol *sym : chunk)
       fn(*sym);
 
   if (ctx.arg.branchToBranch)
@@ -30,12 +30,14 @@ using namespace lld::elf;
 
 void SymbolTable::wrap(Symbol *sym, Symbol *real, Symbol *wrap) {
   // Redirect __real_foo to the original foo and foo to the original __wrap_foo.
-  int &idx1 = symMap[CachedHashStringRef(sym->getName())];
-  int &idx2 = symMap[CachedHashStringRef(real->getName())];
-  int &idx3 = symMap[CachedHashStringRef(wrap->getName())];
+  CachedHashStringRef name1(sym->getName()), name2(real->getName()),
+      name3(wrap->getName());
+  Symbol *&sym1 = symMap[getShardIndex(name1)][name1];
+  Symbol *&sym2 = symMap[getShardIndex(name2)][name2];
+  Symbol *&sym3 = symMap[getShardIndex(name3)][name3];
 
-  idx2 = idx1;
-  idx1 = idx3;
+  sym2 = sym1;
+  sym1 = sym3;
 
   // Propagate symbol usage information to the redirected symbols.
   if (sym->isUsedInRegularObj)
@@ -72,9 +74,11 @@ Symbol *SymbolTable::insert(StringRef name) {
   if (pos != StringRef::npos && pos + 1 < name.size() && name[pos + 1] == '@')
     stem = name.take_front(pos);
 
-  auto p = symMap.insert({CachedHashStringRef(stem), (int)symVector.size()});
+  CachedHashStringRef key(stem);
+  auto p = symMap[getShardIndex(key)].try_emplace(key, nullptr);
   if (!p.second) {
-    Symbol *sym = symVector[p.first->second];
+    Symbol *sym = p.first->second;
+    addPending(sym);
     if (stem.size() != name.size()) {
       sym->setName(name);
       sym->hasVersionSuffix = true;
@@ -83,6 +87,7 @@ Symbol *SymbolTable::insert(StringRef name) {
   }
 
   Symbol *sym = reinterpret_cast<Symbol *>(make<SymbolUnion>());
+  p.first->second = sym;
   symVector.push_back(sym);
 
   // *sym was not initialized by a constructor. Initialize all Symbol fields.
@@ -95,6 +100,33 @@ Symbol *SymbolTable::insert(StringRef name) {
   return sym;
 }
 
+// Unlike insert(), this function may be called from multiple threads. A new
+// symbol is not added to symVector until an input file is parsed and reaches
+// it (see addPending), because the order of symVector determines the order of
+// .symtab and must not depend on thread scheduling. Names with '@' are rare
+// and their handling depends on the order in which they are seen, so they are
+// left to insert().
+Symbol *SymbolTable::insertConcurrent(StringRef name) {
+  if (name.contains('@'))
+    return nullptr;
+
+  CachedHashStringRef key(name);
+  unsigned shard = getShardIndex(key);
+  std::lock_guard<std::mutex> lock(shardMutex[shard]);
+  auto p = symMap[shard].try_emplace(key, nullptr);
+  if (!p.second)
+    return p.first->second;
+
+  Symbol *sym = reinterpret_cast<Symbol *>(makeThreadLocal<SymbolUnion>());
+  memset(static_cast<void *>(sym), 0, sizeof(Symbol));
+  sym->setName(name);
+  sym->partition = 1;
+  sym->versionId = VER_NDX_GLOBAL;
+  sym->pendingInsert = true;
+  p.first->second = sym;
+  return sym;
+}
+
 // This variant of addSymbol is used by BinaryFile::parse to check duplicate
 // symbol errors.
 Symbol *SymbolTable::addAndCheckDuplicate(Ctx &ctx, const Defined &newSym) {
@@ -107,10 +139,12 @@ Symbol *SymbolTable::addAndCheckDuplicate(Ctx &ctx, const Defined &newSym) {
 }
 
 Symbol *SymbolTable::find(StringRef name) {
-  auto it = symMap.find(CachedHashStringRef(name));
-  if (it == symMap.end())
+  CachedHashStringRef key(name);
+  auto &shard = symMap[getShardIndex(key)];
+  auto it = shard.find(key);
+  if (it == shard.end() || it->second->pendingInsert)
     return nullptr;
-  return symVector[it->second];
+  return it->second;
 }
 
 // A version script/dynamic list is only meaningful for a Defined symbol.
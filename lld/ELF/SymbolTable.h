@@ -13,6 +13,7 @@
 #include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Compiler.h"
+#include <mutex>
 
 namespace lld::elf {
 struct Ctx;
@@ -45,6 +46,23 @@ public:
 
   Symbol *insert(StringRef name);
 
+  // Creates a symbol for `name` that is not yet returned by getSymbols(), or
+  // returns the existing one. This is thread-safe with respect to other
+  // insertConcurrent() calls, so that input files can create their global
+  // symbols in parallel before they are parsed. Returns nullptr for versioned
+  // names, which are left to insert().
+  Symbol *insertConcurrent(StringRef name);
+
+  // Called when an input file is parsed and reaches a symbol created by
+  // insertConcurrent(). The first call appends the symbol to getSymbols(), so
+  // the order of getSymbols() is the same as if insert() had been used.
+  void addPending(Symbol *sym) {
+    if (LLVM_UNLIKELY(sym->pendingInsert)) {
+      sym->pendingInsert = false;
+      symVector.push_back(sym);
+    }
+  }
+
   template <typename T> Symbol *addSymbol(const T &newSym) {
     Symbol *sym = insert(newSym.getName());
     sym->resolve(ctx, newSym);
@@ -94,10 +112,19 @@ private:
 
   Ctx &ctx;
 
-  // Global symbols and a map from symbol name to the index. The order is not
-  // defined. We can use an arbitrary order, but it has to be deterministic even
-  // when cross linking.
-  llvm::DenseMap<llvm::CachedHashStringRef, int> symMap;
+  // The map from symbol names to symbols is split into shards selected by the
+  // upper bits of the name hash. Each shard has its own lock, which is only
+  // taken by insertConcurrent().
+  static constexpr unsigned shardBits = 6;
+  static constexpr unsigned numShards = 1 << shardBits;
+  static unsigned getShardIndex(llvm::CachedHashStringRef name) {
+    return name.hash() >> (32 - shardBits);
+  }
+  llvm::DenseMap<llvm::CachedHashStringRef, Symbol *> symMap[numShards];
+  std::mutex shardMutex[numShards];
+
+  // Global symbols. The order is not defined. We can use an arbitrary order,
+  // but it has to be deterministic even when cross linking.
   SmallVector<Symbol *, 0> symVector;
 
   // A map from demangled symbol names to their symbol objects.
@@ -339,6 +339,11 @@ public:
   LLVM_PREFERRED_TYPE(bool)
   uint8_t referencedAfterWrap : 1;
 
+  // True if created by SymbolTable::insertConcurrent and not yet reached by
+  // the serial parse of input files.
+  LLVM_PREFERRED_TYPE(bool)
+  uint8_t pendingInsert : 1;
+
   void setFlags(uint16_t bits) {
     flags.fetch_or(bits, std::memory_order_relaxed);
   }
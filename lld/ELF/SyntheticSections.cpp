@@ -1688,13 +1688,22 @@ RelocationBaseSection::RelocationBaseSection(Ctx &ctx, StringRef name,
       dynamicTag(dynamicTag), sizeDynamicTag(sizeDynamicTag),
       relocsVec(concurrency), combreloc(combreloc) {}
 
+template <bool shard>
 void RelocationBaseSection::addSymbolReloc(
     RelType dynType, InputSectionBase &isec, uint64_t offsetInSec, Symbol &sym,
     int64_t addend, std::optional<RelType> addendRelType) {
-  addReloc(DynamicReloc::AgainstSymbol, dynType, isec, offsetInSec, sym, addend,
-           R_ADDEND, addendRelType ? *addendRelType : ctx.target->noneRel);
+  addReloc<shard>(DynamicReloc::AgainstSymbol, dynType, isec, offsetInSec, sym,
+                  addend, R_ADDEND,
+                  addendRelType ? *addendRelType : ctx.target->noneRel);
 }
 
+template void RelocationBaseSection::addSymbolReloc<false>(
+    RelType, InputSectionBase &, uint64_t, Symbol &, int64_t,
+    std::optional<RelType>);
+template void RelocationBaseSection::addSymbolReloc<true>(
+    RelType, InputSectionBase &, uint64_t, Symbol &, int64_t,
+    std::optional<RelType>);
+
 void RelocationBaseSection::addAddendOnlyRelocIfNonPreemptible(
     RelType dynType, InputSectionBase &isec, uint64_t offsetInSec, Symbol &sym,
     RelType addendRelType) {
@@ -3969,11 +3978,13 @@ void MergeTailSection::finalizeContents() {
 
   // finalize() fixed tail-optimized strings, so we can now get
   // offsets of strings. Get an offset for each string and save it
-  // to a corresponding SectionPiece for easy access.
-  for (MergeInputSection *sec : sections)
+  // to a corresponding SectionPiece for easy access. The builder is no longer
+  // modified, so the lookups can be done in parallel.
+  parallelForEach(sections, [&](MergeInputSection *sec) {
     for (size_t i = 0, e = sec->pieces.size(); i != e; ++i)
       if (sec->pieces[i].live)
         sec->pieces[i].outputOff = builder.getOffset(sec->getData(i));
+  });
 }
 
 void MergeNoTailSection::writeTo(uint8_t *buf) {
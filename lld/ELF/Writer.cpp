@@ -12,6 +12,7 @@
 #include "BPSectionOrderer.h"
 #include "CallGraphSort.h"
 #include "Config.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "LinkerScript.h"
 #include "MapFile.h"
@@ -86,6 +87,8 @@ private:
   std::unique_ptr<FileOutputBuffer> &buffer;
   // ThunkCreator holds Thunks that are used at writeTo time.
   ThunkCreator tc;
+  // Non-null if --incremental is specified.
+  std::unique_ptr<IncrementalLink> incremental;
 
   void addRelIpltSymbols();
   void addStartEndSymbols();
@@ -362,6 +365,11 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (errCount(ctx))
     return;
 
+  if (ctx.arg.incremental) {
+    incremental = std::make_unique<IncrementalLink>(ctx);
+    incremental->prepare<ELFT>(fileSize);
+  }
+
   {
     llvm::TimeTraceScope timeScope("Write output file");
     // Write the result down to a file.
@@ -388,6 +396,8 @@ template <class ELFT> void Writer<ELFT>::run() {
       if (auto e = buffer->commit())
         Err(ctx) << "failed to write output '" << buffer->getPath()
                  << "': " << std::move(e);
+      else if (incremental)
+        incremental->saveState();
     }
 
     if (!ctx.arg.cmseOutputLib.empty())
@@ -2926,6 +2936,27 @@ template <class ELFT> void Writer<ELFT>::openFile() {
     return;
   }
 
+  // With --incremental, the state file of the previous link no longer
+  // describes the output once we start writing.
+  if (incremental)
+    incremental->removeState();
+
+  if (incremental && incremental->canReuseOutput()) {
+    Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+        FileOutputBuffer::create(ctx.arg.outputFile, fileSize,
+                                 FileOutputBuffer::F_modify);
+    if (bufferOrErr) {
+      buffer = std::move(*bufferOrErr);
+      ctx.bufferStart = buffer->getBufferStart();
+      incremental->clearStaleRange(ctx.bufferStart, fileSize);
+      return;
+    }
+    // For example, the output may be an executable that is still running.
+    Log(ctx) << "--incremental: cannot update " << ctx.arg.outputFile
+             << " in place: " << bufferOrErr.takeError();
+    incremental->disableReuse();
+  }
+
   unlinkAsync(ctx.arg.outputFile);
   unsigned flags = 0;
   if (!ctx.arg.relocatable)
@@ -3006,9 +3037,15 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
   }
   {
     parallel::TaskGroup tg;
-    for (OutputSection *sec : ctx.outputSections)
-      if (!isStaticRelSecType(sec->type))
+    for (OutputSection *sec : ctx.outputSections) {
+      if (isStaticRelSecType(sec->type))
+        continue;
+      if (!incremental)
         sec->writeTo<ELFT>(ctx, ctx.bufferStart + sec->offset, tg);
+      else if (!incremental->isClean(sec))
+        sec->writeTo<ELFT>(ctx, ctx.bufferStart + sec->offset, tg,
+                           incremental->getDirtyInputSections(sec));
+    }
   }
 
   // Finally, check that all dynamic relocation addends were written correctly.
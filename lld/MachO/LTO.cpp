@@ -212,6 +212,13 @@ std::vector<ObjFile *> BitcodeCompiler::compile() {
         },
         cache));
 
+  if (const FileCacheStats *stats = cache.getStats()) {
+    std::string s;
+    raw_string_ostream os(s);
+    stats->print(os);
+    log("-cache_path_lto: " + s);
+  }
+
   // Emit empty index files for non-indexed files
   for (StringRef s : thinIndices) {
     std::string path = getThinLTOOutputFile(s);
@@ -1596,15 +1596,30 @@ uint64_t CodeSignatureSection::getRawSize() const {
   return allHeadersSize + getBlockCount() * hashSize;
 }
 
-void CodeSignatureSection::writeHashes(uint8_t *buf) const {
+void CodeSignatureSection::hashBlock(const uint8_t *buf, size_t i,
+                                     uint8_t *hash) const {
   // NOTE: Changes to this functionality should be repeated in llvm-objcopy's
   // MachOWriter::writeSignatureData.
+  sha256(buf + i * blockSize,
+         std::min(static_cast<size_t>(fileOff - i * blockSize), blockSize),
+         hash);
+}
+
+void CodeSignatureSection::writeHashes(uint8_t *buf) const {
   uint8_t *hashes = buf + fileOff + allHeadersSize;
-  parallelFor(0, getBlockCount(), [&](size_t i) {
-    sha256(buf + i * blockSize,
-           std::min(static_cast<size_t>(fileOff - i * blockSize), blockSize),
-           hashes + i * hashSize);
-  });
+  parallelFor(0, getBlockCount(),
+              [&](size_t i) { hashBlock(buf, i, hashes + i * hashSize); });
+  invalidateSignatureCache(buf);
+}
+
+void CodeSignatureSection::writeHashes(uint8_t *buf,
+                                       ArrayRef<uint8_t> hashes) const {
+  assert(hashes.size() == getBlockCount() * hashSize);
+  memcpy(buf + fileOff + allHeadersSize, hashes.data(), hashes.size());
+  invalidateSignatureCache(buf);
+}
+
+void CodeSignatureSection::invalidateSignatureCache(uint8_t *buf) const {
 #if defined(__APPLE__)
   // This is macOS-specific work-around and makes no sense for any
   // other host OS. See https://openradar.appspot.com/FB8914231
@@ -547,7 +547,14 @@ public:
   bool isNeeded() const override { return true; }
   void writeTo(uint8_t *buf) const override;
   uint32_t getBlockCount() const;
+  // Computes the hash of the i-th block of the output file.
+  void hashBlock(const uint8_t *buf, size_t i, uint8_t *hash) const;
   void writeHashes(uint8_t *buf) const;
+  // Writes hashes that have already been computed with hashBlock().
+  void writeHashes(uint8_t *buf, ArrayRef<uint8_t> hashes) const;
+
+private:
+  void invalidateSignatureCache(uint8_t *buf) const;
 };
 
 class CStringSection : public SyntheticSection {
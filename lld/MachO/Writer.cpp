@@ -78,6 +78,9 @@ public:
 
   LCUuid *uuidCommand = nullptr;
   OutputSegment *linkEditSegment = nullptr;
+
+  // Code signature hashes computed by writeUuid(), if any.
+  std::vector<uint8_t> codeSignatureHashes;
 };
 
 // LC_DYLD_INFO_ONLY stores the offsets of symbol import/export information.
@@ -1223,16 +1226,40 @@ void Writer::applyOptimizationHints() {
 // In order to utilize multiple cores, we first split the buffer into chunks,
 // compute a hash for each chunk, and then compute a hash value of the hash
 // values.
+//
+// The code signature also needs to hash every page of the output, so we
+// compute its hashes in the same pass while each chunk is in cache instead of
+// reading the whole output twice. Only the pages containing the UUID itself
+// need to be hashed again by writeCodeSignature(). The code signature hashes
+// are written to the output later because the UUID covers the whole output,
+// including the code signature section.
 void Writer::writeUuid() {
   TimeTraceScope timeScope("Computing UUID");
 
-  ArrayRef<uint8_t> data{buffer->getBufferStart(), buffer->getBufferEnd()};
-  std::vector<ArrayRef<uint8_t>> chunks = split(data, 1024 * 1024);
+  const uint8_t *buf = buffer->getBufferStart();
+  ArrayRef<uint8_t> data{buf, buffer->getBufferEnd()};
+  constexpr size_t chunkSize = 1024 * 1024;
+  static_assert(chunkSize % CodeSignatureSection::blockSize == 0);
+  std::vector<ArrayRef<uint8_t>> chunks = split(data, chunkSize);
+
+  size_t blockCount = 0;
+  if (codeSignatureSection) {
+    blockCount = codeSignatureSection->getBlockCount();
+    codeSignatureHashes.resize(blockCount * CodeSignatureSection::hashSize);
+  }
 
   // Leave one slot for filename
   std::vector<uint64_t> hashes(chunks.size() + 1);
-  parallelFor(0, chunks.size(),
-              [&](size_t i) { hashes[i] = xxh3_64bits(chunks[i]); });
+  parallelFor(0, chunks.size(), [&](size_t i) {
+    hashes[i] = xxh3_64bits(chunks[i]);
+
+    const size_t blocksPerChunk = chunkSize / CodeSignatureSection::blockSize;
+    for (size_t j = i * blocksPerChunk,
+                e = std::min((i + 1) * blocksPerChunk, blockCount);
+         j < e; ++j)
+      codeSignatureSection->hashBlock(
+          buf, j, &codeSignatureHashes[j * CodeSignatureSection::hashSize]);
+  });
   // Append the output filename so that identical binaries with different names
   // don't get the same UUID.
   hashes[chunks.size()] = xxh3_64bits(sys::path::filename(config->finalOutput));
@@ -1290,10 +1317,24 @@ void Writer::buildFixupChains() {
 }
 
 void Writer::writeCodeSignature() {
-  if (codeSignatureSection) {
-    TimeTraceScope timeScope("Write code signature");
-    codeSignatureSection->writeHashes(buffer->getBufferStart());
+  if (!codeSignatureSection)
+    return;
+  TimeTraceScope timeScope("Write code signature");
+  uint8_t *buf = buffer->getBufferStart();
+  if (codeSignatureHashes.empty()) {
+    codeSignatureSection->writeHashes(buf);
+    return;
   }
+
+  // Rehash the pages that were modified by writeUuid().
+  constexpr size_t blockSize = CodeSignatureSection::blockSize;
+  size_t uuidOff = uuidCommand->uuidBuf - buf;
+  for (size_t i = uuidOff / blockSize,
+              e = (uuidOff + sizeof(uuid_command::uuid) - 1) / blockSize;
+       i <= e; ++i)
+    codeSignatureSection->hashBlock(
+        buf, i, &codeSignatureHashes[i * CodeSignatureSection::hashSize]);
+  codeSignatureSection->writeHashes(buf, codeSignatureHashes);
 }
 
 void Writer::writeOutputFile() {
@@ -96,6 +96,7 @@ public:
 
   uint64_t errorCount = 0;
   uint64_t errorLimit = 20;
+  uint64_t warningCount = 0;
   StringRef errorLimitExceededMsg = "too many errors emitted, stopping now";
   StringRef errorHandlingScript;
   StringRef logName = "lld";
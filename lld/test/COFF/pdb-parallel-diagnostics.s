@@ -0,0 +1,36 @@
+# REQUIRES: x86
+## The .debug$S sections of the object files are analyzed in parallel, but
+## the warnings found there are reported in file order.
+
+# RUN: rm -rf %t && split-file %s %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc main.s -o main.obj
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc a.s -o a.obj
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc b.s -o b.obj
+# RUN: lld-link /threads:4 /debug /entry:main /out:out.exe main.obj a.obj \
+# RUN:   b.obj 2>&1 | FileCheck %s --check-prefix=AB
+# RUN: lld-link /threads:4 /debug /entry:main /out:out.exe main.obj b.obj \
+# RUN:   a.obj 2>&1 | FileCheck %s --check-prefix=BA
+
+# AB:      warning: ignoring unknown debug$S subsection kind 0xAA in file a.obj
+# AB-NEXT: warning: ignoring unknown debug$S subsection kind 0xBB in file b.obj
+
+# BA:      warning: ignoring unknown debug$S subsection kind 0xBB in file b.obj
+# BA-NEXT: warning: ignoring unknown debug$S subsection kind 0xAA in file a.obj
+
+#--- main.s
+.text
+.globl main
+main:
+  ret
+
+#--- a.s
+.section .debug$S,"dr"
+.long 4
+.long 0xaa
+.long 0
+
+#--- b.s
+.section .debug$S,"dr"
+.long 4
+.long 0xbb
+.long 0
@@ -0,0 +1,18 @@
+# REQUIRES: arm
+## --out-implib writes a second output file, which a cache hit would not
+## write, so it bypasses --link-cache-dir.
+
+# RUN: llvm-mc -arm-add-build-attributes -filetype=obj -triple=thumbv8m.main %s -o %t.o
+# RUN: ld.lld --link-cache-dir=%t.cache --verbose --cmse-implib \
+# RUN:   -Ttext=0x8000 --section-start .gnu.sgstubs=0x20000 %t.o -o %t \
+# RUN:   --out-implib=%t.lib.o 2>&1 | FileCheck %s
+# RUN: not ls %t.cache/llvmcache-*
+
+# CHECK: --link-cache-dir: not using the cache because --out-implib is specified
+
+  .text
+  .thumb
+  .globl _start
+  .type _start, %function
+_start:
+  bx lr
@@ -0,0 +1,36 @@
+# REQUIRES: x86
+## Without --threads=1, --gc-sections scans the relocations of live sections in
+## parallel. The result must not depend on the thread count, including for
+## SHF_MERGE sections kept alive by their section group or by a __start_
+## reference rather than by a relocation to one of their pieces.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o %t.o
+# RUN: ld.lld --gc-sections --threads=1 %t.o -o %t1
+# RUN: ld.lld --gc-sections --threads=2 %t.o -o %t2
+# RUN: cmp %t1 %t2
+# RUN: llvm-readelf -p .rodata -p cstr %t2 | FileCheck %s --implicit-check-not=dead
+
+# CHECK:      String dump of section '.rodata':
+# CHECK-NEXT: [     0] group
+# CHECK:      String dump of section 'cstr':
+# CHECK-NEXT: [     0] cnamed
+
+.globl _start
+_start:
+  call foo
+  .quad __start_cstr
+
+## Only reached as the next member of the group of .text.foo.
+.section .text.foo,"axG",@progbits,grp,comdat
+.globl foo
+foo:
+  ret
+.section .rodata.grp,"aMSG",@progbits,1,grp,comdat
+.asciz "group"
+
+## Only reached through __start_cstr.
+.section cstr,"aMS",@progbits,1
+.asciz "cnamed"
+
+.section .rodata.dead,"aMS",@progbits,1
+.asciz "dead"
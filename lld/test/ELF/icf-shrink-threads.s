@@ -0,0 +1,40 @@
+# REQUIRES: x86
+## ICF chooses between the multi-threaded and the single-threaded mode once.
+## Here, more than 1024 sections survive hashing, so the first comparison runs
+## multi-threaded, but comparing contents then leaves only 4 sections. The
+## later iterations must keep reading the classes computed by the comparison
+## rather than the ones from hashing, otherwise the .text and .rodata sections
+## below, which have the same contents, would be folded together.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o %t.o
+# RUN: ld.lld --threads=2 --icf=all --print-icf-sections --verbose %t.o \
+# RUN:   -o /dev/null 2>&1 | FileCheck %s --implicit-check-not=removing
+
+# CHECK:     ICF: 1044 of {{[0-9]+}} eligible sections remain after hashing
+# CHECK:     ICF: 4 sections remain after comparing contents
+# CHECK-DAG: removing identical section {{.*}}:(.text.a2)
+# CHECK-DAG: removing identical section {{.*}}:(.rodata.b2)
+
+.globl _start
+_start:
+  ret
+
+## 520 pairs of sections that have the same contents but different flags.
+.macro pair
+.section .text.f\@,"ax",@progbits
+.quad \@
+.section .rodata.g\@,"a",@progbits
+.quad \@
+.endm
+.rept 520
+pair
+.endr
+
+.section .text.a1,"ax",@progbits
+.quad 0x12345678
+.section .text.a2,"ax",@progbits
+.quad 0x12345678
+.section .rodata.b1,"a",@progbits
+.quad 0x12345678
+.section .rodata.b2,"a",@progbits
+.quad 0x12345678
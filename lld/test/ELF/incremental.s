@@ -0,0 +1,118 @@
+# REQUIRES: x86
+## Test --incremental: the first link writes a state file next to the output,
+## a relink that keeps the memory image layout updates the output in place,
+## and any other relink falls back to writing the whole output. In all cases
+## the output must be identical to the one of a clean link.
+
+# RUN: rm -rf %t && split-file %s %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 a.s -o a.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b1.s -o b1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b2.s -o b2.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b3.s -o b3.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b4.s -o b4.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 c.s -o c.o
+
+## The first link writes the whole output and the state file.
+# RUN: cp b1.o b.o
+# RUN: ld.lld --incremental --verbose a.o b.o c.o -o out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=FULL
+# RUN: ls out.lld-incr
+# RUN: ld.lld a.o b.o c.o -o clean
+# RUN: cmp out clean
+
+# FULL-NOT: --incremental: updating
+
+## Changing the contents of b.o without moving anything updates the output in
+## place.
+# RUN: cp b2.o b.o
+# RUN: ld.lld --incremental --verbose a.o b.o c.o -o out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=INPLACE
+# RUN: ld.lld a.o b.o c.o -o clean
+# RUN: cmp out clean
+
+# INPLACE: --incremental: updating out in place, rewriting {{[0-9]+}} of {{[0-9]+}} input sections
+
+## Raising the alignment of b.o's .text moves it from offset 4 to offset 8
+## within .text but keeps the size of .text. The bytes at offset 4 are now
+## padding and must be refilled even though a.o's .text is not rewritten.
+# RUN: cp b3.o b.o
+# RUN: ld.lld --incremental --verbose a.o b.o c.o -o out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=INPLACE
+# RUN: ld.lld a.o b.o c.o -o clean
+# RUN: cmp out clean
+
+## Growing .text changes the memory image layout, so the whole output is
+## written again and a new state file is written.
+# RUN: cp b4.o b.o
+# RUN: ld.lld --incremental --verbose a.o b.o c.o -o out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=FULL
+# RUN: ld.lld a.o b.o c.o -o clean
+# RUN: cmp out clean
+# RUN: ls out.lld-incr
+
+## A change of options also falls back to a full link.
+# RUN: ld.lld --incremental --verbose -z norelro a.o b.o c.o -o out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=FULL
+# RUN: ld.lld -z norelro a.o b.o c.o -o clean
+# RUN: cmp out clean
+
+## --incremental-padding lays out executable input sections on the given
+## boundary, so that they can grow in place.
+# RUN: cp b1.o b.o
+# RUN: ld.lld --incremental --incremental-padding=64 --verbose a.o b.o c.o \
+# RUN:   -o pad 2>&1 | FileCheck %s --check-prefix=FULL
+# RUN: llvm-readelf -s pad | FileCheck %s --check-prefix=PAD
+# RUN: cp b4.o b.o
+# RUN: ld.lld --incremental --incremental-padding=64 --verbose a.o b.o c.o \
+# RUN:   -o pad 2>&1 | FileCheck %s --check-prefix=INPLACE
+# RUN: ld.lld --incremental-padding=64 a.o b.o c.o -o clean
+# RUN: cmp pad clean
+
+# PAD-DAG: {{[0-9a-f]*[048c]0}} 0 NOTYPE GLOBAL DEFAULT [[#]] b
+# PAD-DAG: {{[0-9a-f]*[048c]0}} 0 NOTYPE GLOBAL DEFAULT [[#]] c
+
+# RUN: not ld.lld --incremental-padding=3 a.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=ERR-PAD
+# RUN: not ld.lld --incremental -r a.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=ERR-R
+# RUN: not ld.lld --incremental --emit-relocs a.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=ERR-EMIT
+
+# ERR-PAD: error: --incremental-padding: value isn't a power of 2
+# ERR-R: error: -r and --incremental may not be used together
+# ERR-EMIT: error: --incremental and --emit-relocs may not be used together
+
+#--- a.s
+.globl _start
+_start:
+  nop
+
+#--- b1.s
+.p2align 2
+.globl b
+b:
+  nop
+
+#--- b2.s
+.p2align 2
+.globl b
+b:
+  ret
+
+#--- b3.s
+.p2align 3
+.globl b
+b:
+  nop
+
+#--- b4.s
+.p2align 2
+.globl b
+b:
+  .fill 32, 1, 0x90
+
+#--- c.s
+.p2align 4
+.globl c
+c:
+  call b
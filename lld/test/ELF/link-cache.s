@@ -0,0 +1,100 @@
+# REQUIRES: x86
+## Test --link-cache-dir and --link-cache-policy.
+
+# RUN: rm -rf %t && split-file %s %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 a.s -o a.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b.s -o b.o
+
+## A miss links as usual and adds the output to the cache.
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out1 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=MISS
+# RUN: ls cache | grep '^llvmcache-' | count 1
+# RUN: ld.lld a.o -o clean
+# RUN: cmp out1 clean
+
+# MISS-NOT: --link-cache-dir: using
+
+## A hit creates the output from the cache entry. The output path is not part
+## of the key.
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out2 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=HIT
+# RUN: cmp out2 clean
+# RUN: ls cache | grep '^llvmcache-' | count 1
+
+# HIT: --link-cache-dir: using {{.*}}llvmcache-
+
+## Changing an option or an input misses.
+# RUN: ld.lld --link-cache-dir=cache --verbose -z norelro a.o -o out3 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=MISS
+# RUN: cp b.o c.o
+# RUN: ld.lld --link-cache-dir=cache --verbose c.o -o out4 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=MISS
+# RUN: ls cache | grep '^llvmcache-' | count 3
+
+## Options that write something other than the output file, or that make the
+## output differ from one link to the next, bypass the cache.
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out5 -Map=out5.map \
+# RUN:   2>&1 | FileCheck %s --check-prefix=UNCACHEABLE -DOPT=-Map
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out5 --cref 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=UNCACHEABLE -DOPT=--cref
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out5 \
+# RUN:   --shuffle-sections='*=0' 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=UNCACHEABLE -DOPT='--shuffle-sections=<pattern>=0'
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out5 --build-id=uuid \
+# RUN:   2>&1 | FileCheck %s --check-prefix=UNCACHEABLE -DOPT=--build-id=uuid
+# RUN: ls cache | grep '^llvmcache-' | count 3
+
+## A fixed seed gives the same output every time, so it can be cached.
+# RUN: ld.lld --link-cache-dir=cache --verbose a.o -o out5 \
+# RUN:   --shuffle-sections='*=1' 2>&1 | FileCheck %s --check-prefix=MISS
+# RUN: ls cache | grep '^llvmcache-' | count 4
+
+# UNCACHEABLE: --link-cache-dir: not using the cache because [[OPT]] is specified
+# UNCACHEABLE-NOT: --link-cache-dir: using
+
+## With a limit of one entry, adding an entry prunes the others.
+# RUN: ld.lld --link-cache-dir=cache \
+# RUN:   --link-cache-policy=prune_interval=0s:cache_size_files=1 b.o -o out6
+# RUN: ls cache | grep '^llvmcache-' | count 1
+
+## Each entry records the time taken by the link that added it. With
+## prune_by=cost, an entry without a recorded time is removed first, even if
+## it was used more recently than the others.
+# RUN: ld.lld --link-cache-dir=cache2 a.o -o out7
+# RUN: ld.lld --link-cache-dir=cache2 b.o -o out7
+# RUN: ls cache2 | grep '^llvmcache.cost-' | count 2
+# RUN: ld.lld --link-cache-dir=cache2 --verbose b.o -o out7 2> hit.log
+# RUN: %python rmcost.py hit.log
+# RUN: ls cache2 | grep '^llvmcache.cost-' | count 1
+# RUN: ld.lld --link-cache-dir=cache2 \
+# RUN:   --link-cache-policy=prune_interval=0s:cache_size_files=2:prune_by=cost \
+# RUN:   c.o -o out7
+# RUN: ls cache2 | grep '^llvmcache-' | count 2
+# RUN: ld.lld --link-cache-dir=cache2 --verbose a.o -o out7 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=HIT
+# RUN: ld.lld --link-cache-dir=cache2 --verbose b.o -o out7 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=MISS
+
+# RUN: not ld.lld --link-cache-dir=cache --link-cache-policy=foo a.o \
+# RUN:   -o /dev/null 2>&1 | FileCheck %s --check-prefix=ERR-POLICY
+
+# ERR-POLICY: error: --link-cache-policy: invalid cache policy: Unknown key: 'foo'
+
+#--- a.s
+.globl _start
+_start:
+  ret
+
+#--- b.s
+.globl _start
+_start:
+  nop
+  ret
+
+#--- rmcost.py
+## Removes the cost file of the entry used by the link that wrote the log.
+import os, re, sys
+
+path = re.search(r"--link-cache-dir: using (\S+)", open(sys.argv[1]).read())[1]
+dir, name = os.path.split(path)
+os.remove(os.path.join(dir, name.replace("llvmcache-", "llvmcache.cost-", 1)))
@@ -0,0 +1,30 @@
+# REQUIRES: x86
+## The symbol tables of the bitcode members of an archive are read in
+## parallel. A malformed member is still reported from the linker thread,
+## and the first one in member order is the one reported.
+
+# RUN: rm -rf %t && split-file %s %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 main.s -o main.o
+# RUN: llvm-as good.ll -o good.bc
+# RUN: printf 'BC\300\336\1\2\3\4' > bad1.bc
+# RUN: printf 'BC\300\336\5\6\7\10' > bad2.bc
+# RUN: llvm-ar rc lib.a good.bc bad1.bc bad2.bc
+# RUN: not ld.lld --threads=4 main.o lib.a -o /dev/null 2>&1 | FileCheck %s
+# RUN: not ld.lld --threads=4 main.o --whole-archive lib.a -o /dev/null 2>&1 | \
+# RUN:   FileCheck %s
+
+# CHECK:     error: lib.a(bad1.bc):
+# CHECK-NOT: bad2.bc
+
+#--- main.s
+.globl _start
+_start:
+  call good
+
+#--- good.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-i128:128-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @good() {
+  ret void
+}
@@ -0,0 +1,54 @@
+# REQUIRES: x86
+## Test --print-input-costs=. Times are not deterministic, so only the layout
+## of the table and the byte counts are checked. Each archive member gets a
+## row, and the archive gets a row that sums the costs of its members,
+## including the members that were not extracted.
+
+# RUN: rm -rf %t && split-file %s %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 main.s -o main.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 foo.s -o foo.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 unused.s -o unused.o
+# RUN: llvm-ar rc lib.a foo.o unused.o
+# RUN: ld.lld main.o lib.a -o out --print-input-costs=costs.txt
+# RUN: FileCheck %s --input-file=costs.txt --implicit-check-not={{^}}file \
+# RUN:   --implicit-check-not={{^}}archive
+
+# CHECK:     kind total_ms parse_ms scan_relocs_ms write_ms input_bytes output_bytes folded_bytes name
+# CHECK-DAG: {{^}}file {{[0-9.]+ [0-9.]+ [0-9.]+ [0-9.]+ [0-9]+}} 13 0 main.o{{$}}
+# CHECK-DAG: {{^}}file {{[0-9.]+ [0-9.]+ [0-9.]+ [0-9.]+ [0-9]+}} 9 0 lib.a(foo.o){{$}}
+# CHECK-DAG: {{^}}file {{[0-9.]+ [0-9.]+ [0-9.]+ [0-9.]+ [0-9]+}} 0 0 lib.a(unused.o){{$}}
+# CHECK-DAG: {{^}}archive {{[0-9.]+ [0-9.]+ [0-9.]+ [0-9.]+ [0-9]+}} 9 0 lib.a{{$}}
+
+## With --icf=all, the bytes of a folded section are attributed to the file
+## that contained it.
+# RUN: ld.lld main.o foo.o --icf=all -o out --print-input-costs=- | \
+# RUN:   FileCheck %s --check-prefix=ICF
+
+# ICF-DAG: {{^}}file {{[0-9.]+ [0-9.]+ [0-9.]+ [0-9.]+ [0-9]+}} 13 0 main.o{{$}}
+# ICF-DAG: {{^}}file {{[0-9.]+ [0-9.]+ [0-9.]+ [0-9.]+ [0-9]+}} 1 8 foo.o{{$}}
+
+# RUN: not ld.lld main.o lib.a -o out --print-input-costs=dir/costs.txt 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=ERR
+
+# ERR: error: --print-input-costs=: cannot open dir/costs.txt
+
+#--- main.s
+.globl _start
+_start:
+  call foo
+
+.section .rodata.a,"a",@progbits
+.quad 0x1234567812345678
+
+#--- foo.s
+.globl foo
+foo:
+  ret
+
+.section .rodata.b,"a",@progbits
+.quad 0x1234567812345678
+
+#--- unused.s
+.globl bar
+bar:
+  nop
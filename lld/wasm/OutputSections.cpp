@@ -16,6 +16,7 @@
 #include "lld/Common/Memory.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/Parallel.h"
 
 #define DEBUG_TYPE "lld"
 
@@ -45,6 +46,26 @@ void OutputSection::createHeader(size_t bodySize) {
       " total=" + Twine(getSize()));
 }
 
+// Writes chunks to buf in tasks of up to 4 MiB each. Large sections are thus
+// written in parallel, and the writes of small sections overlap with those of
+// other sections.
+template <class T>
+static void writeChunks(ArrayRef<T *> chunks, uint8_t *buf,
+                        parallel::TaskGroup &tg) {
+  const size_t taskSizeLimit = 4 << 20;
+  for (size_t begin = 0, i = 0, taskSize = 0; i != chunks.size();) {
+    taskSize += chunks[i]->getSize();
+    if (++i == chunks.size() || taskSize >= taskSizeLimit) {
+      tg.spawn([=] {
+        for (const T *chunk : chunks.slice(begin, i - begin))
+          chunk->writeTo(buf);
+      });
+      begin = i;
+      taskSize = 0;
+    }
+  }
+}
+
 void CodeSection::finalizeContents() {
   raw_string_ostream os(codeSectionHeader);
   writeUleb128(os, functions.size(), "function count");
@@ -62,7 +83,7 @@ void CodeSection::finalizeContents() {
   createHeader(bodySize);
 }
 
-void CodeSection::writeTo(uint8_t *buf) {
+void CodeSection::writeTo(uint8_t *buf, parallel::TaskGroup &tg) {
   log("writing " + toString(*this) + " offset=" + Twine(offset) +
       " size=" + Twine(getSize()));
   log(" headersize=" + Twine(header.size()));
@@ -77,8 +98,7 @@ void CodeSection::writeTo(uint8_t *buf) {
   memcpy(buf, codeSectionHeader.data(), codeSectionHeader.size());
 
   // Write code section bodies
-  for (const InputChunk *chunk : functions)
-    chunk->writeTo(buf);
+  writeChunks(functions, buf, tg);
 }
 
 uint32_t CodeSection::getNumRelocations() const {
@@ -160,7 +180,7 @@ void DataSection::finalizeContents() {
   createHeader(bodySize);
 }
 
-void DataSection::writeTo(uint8_t *buf) {
+void DataSection::writeTo(uint8_t *buf, parallel::TaskGroup &tg) {
   log("writing " + toString(*this) + " offset=" + Twine(offset) +
       " size=" + Twine(getSize()) + " body=" + Twine(bodySize));
   buf += offset;
@@ -180,8 +200,7 @@ void DataSection::writeTo(uint8_t *buf) {
     memcpy(segStart, segment->header.data(), segment->header.size());
 
     // Write segment data payload
-    for (const InputChunk *chunk : segment->inputSegments)
-      chunk->writeTo(buf);
+    writeChunks(ArrayRef(segment->inputSegments), buf, tg);
   }
 }
 
@@ -252,7 +271,7 @@ void CustomSection::finalizeContents() {
   createHeader(payloadSize + nameData.size());
 }
 
-void CustomSection::writeTo(uint8_t *buf) {
+void CustomSection::writeTo(uint8_t *buf, parallel::TaskGroup &tg) {
   log("writing " + toString(*this) + " offset=" + Twine(offset) +
       " size=" + Twine(getSize()) + " chunks=" + Twine(inputSections.size()));
 
@@ -266,8 +285,7 @@ void CustomSection::writeTo(uint8_t *buf) {
   buf += nameData.size();
 
   // Write custom sections payload
-  for (const InputChunk *section : inputSections)
-    section->writeTo(buf);
+  writeChunks(ArrayRef(inputSections), buf, tg);
 }
 
 uint32_t CustomSection::getNumRelocations() const {
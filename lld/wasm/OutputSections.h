@@ -15,6 +15,10 @@
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/DenseMap.h"
 
+namespace llvm::parallel {
+class TaskGroup;
+}
+
 namespace lld {
 
 namespace wasm {
@@ -38,7 +42,9 @@ public:
   virtual bool isNeeded() const { return true; }
   virtual size_t getSize() const = 0;
   virtual size_t getOffset() { return offset; }
-  virtual void writeTo(uint8_t *buf) = 0;
+  // Writes the section to buf. Content that takes a while to write may be
+  // written by tasks spawned in tg.
+  virtual void writeTo(uint8_t *buf, llvm::parallel::TaskGroup &tg) = 0;
   virtual void finalizeContents() = 0;
   virtual uint32_t getNumRelocations() const { return 0; }
   virtual uint32_t getNumLiveRelocations() const { return getNumRelocations(); }
@@ -64,7 +70,7 @@ public:
   }
 
   size_t getSize() const override { return header.size() + bodySize; }
-  void writeTo(uint8_t *buf) override;
+  void writeTo(uint8_t *buf, llvm::parallel::TaskGroup &tg) override;
   uint32_t getNumRelocations() const override;
   void writeRelocations(raw_ostream &os) const override;
   bool isNeeded() const override { return functions.size() > 0; }
@@ -87,7 +93,7 @@ public:
   }
 
   size_t getSize() const override { return header.size() + bodySize; }
-  void writeTo(uint8_t *buf) override;
+  void writeTo(uint8_t *buf, llvm::parallel::TaskGroup &tg) override;
   uint32_t getNumRelocations() const override;
   void writeRelocations(raw_ostream &os) const override;
   bool isNeeded() const override;
@@ -120,7 +126,7 @@ public:
   size_t getSize() const override {
     return header.size() + nameData.size() + payloadSize;
   }
-  void writeTo(uint8_t *buf) override;
+  void writeTo(uint8_t *buf, llvm::parallel::TaskGroup &tg) override;
   uint32_t getNumRelocations() const override;
   void writeRelocations(raw_ostream &os) const override;
   void finalizeContents() override;
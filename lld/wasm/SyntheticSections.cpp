@@ -17,6 +17,7 @@
 #include "OutputSegment.h"
 #include "SymbolTable.h"
 #include "llvm/BinaryFormat/Wasm.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include <optional>
 
@@ -820,16 +821,28 @@ void NameSection::writeBody() {
         writeStr(sub.os, toString(*s), "symbol name");
       }
     }
-    for (const InputFunction *f : out.functionSec->inputFunctions) {
-      if (!f->name.empty()) {
-        writeUleb128(sub.os, f->getFunctionIndex(), "func index");
-        if (!f->debugName.empty()) {
-          writeStr(sub.os, f->debugName, "symbol name");
-        } else {
-          writeStr(sub.os, maybeDemangleSymbol(f->name), "symbol name");
+    // Demangling dominates the time spent here for large modules, so encode
+    // the names of defined functions in parallel shards and concatenate them.
+    ArrayRef<InputFunction *> funcs = out.functionSec->inputFunctions;
+    const size_t shardSize = 4096;
+    std::vector<std::string> shards(divideCeil(funcs.size(), shardSize));
+    parallelFor(0, shards.size(), [&](size_t i) {
+      raw_string_ostream os(shards[i]);
+      size_t begin = i * shardSize;
+      size_t end = std::min(begin + shardSize, funcs.size());
+      for (const InputFunction *f : funcs.slice(begin, end - begin)) {
+        if (!f->name.empty()) {
+          writeUleb128(os, f->getFunctionIndex(), "func index");
+          if (!f->debugName.empty()) {
+            writeStr(os, f->debugName, "symbol name");
+          } else {
+            writeStr(os, maybeDemangleSymbol(f->name), "symbol name");
+          }
         }
       }
-    }
+    });
+    for (const std::string &shard : shards)
+      sub.os << shard;
     sub.writeTo(bodyOutputStream);
   }
 
@@ -219,10 +219,11 @@ void Writer::writeHeader() {
 
 void Writer::writeSections() {
   uint8_t *buf = buffer->getBufferStart();
-  parallelForEach(outputSections, [buf](OutputSection *s) {
+  parallel::TaskGroup tg;
+  for (OutputSection *s : outputSections) {
     assert(s->isNeeded());
-    s->writeTo(buf);
-  });
+    s->writeTo(buf, tg);
+  }
 }
 
 // Computes a hash value of Data using a given hash function.
@@ -0,0 +1,116 @@
+//===- ParallelBM.cpp - Benchmarks for llvm/Support/Parallel.h ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures the scheduling overhead and the scaling of the parallel algorithms.
+// The executor is created on first use and keeps its thread count, so scaling
+// is measured by running the benchmark with different values of
+// --parallel-threads=N (default: all hardware threads).
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Parallel.h"
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+// Items that do almost no work, so the time is dominated by scheduling.
+static void BM_ParallelForEmpty(benchmark::State &State) {
+  std::vector<uint32_t> Data(State.range(0));
+  for (auto _ : State) {
+    parallelFor(0, Data.size(), [&](size_t I) { Data[I] = I; });
+    benchmark::DoNotOptimize(Data.data());
+  }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(BM_ParallelForEmpty)->Arg(16)->Arg(1024)->Arg(1 << 20);
+
+// Items whose cost grows with the index, so a static partitioning leaves most
+// threads idle near the end.
+static void BM_ParallelForSkewed(benchmark::State &State) {
+  size_t N = State.range(0);
+  std::vector<uint64_t> Data(N);
+  for (auto _ : State) {
+    parallelFor(0, N, [&](size_t I) {
+      uint64_t X = I;
+      for (size_t J = 0, E = I * 64 / N * 64; J != E; ++J)
+        X = X * 6364136223846793005ULL + 1442695040888963407ULL;
+      Data[I] = X;
+    });
+    benchmark::DoNotOptimize(Data.data());
+  }
+  State.SetItemsProcessed(State.iterations() * N);
+}
+BENCHMARK(BM_ParallelForSkewed)->Arg(1 << 12)->Arg(1 << 16);
+
+// Many tiny tasks spawned from one thread.
+static void BM_TaskGroupSpawn(benchmark::State &State) {
+  for (auto _ : State) {
+    std::atomic<size_t> Count{0};
+    {
+      parallel::TaskGroup TG;
+      for (int64_t I = 0; I != State.range(0); ++I)
+        TG.spawn([&] { Count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    benchmark::DoNotOptimize(Count.load());
+  }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(BM_TaskGroupSpawn)->Arg(1024)->Arg(1 << 16);
+
+// Tasks spawned recursively from worker threads.
+static void BM_ParallelSort(benchmark::State &State) {
+  std::vector<uint32_t> Input(State.range(0));
+  std::mt19937 Rng(0);
+  for (uint32_t &X : Input)
+    X = Rng();
+  std::vector<uint32_t> Data;
+  for (auto _ : State) {
+    State.PauseTiming();
+    Data = Input;
+    State.ResumeTiming();
+    parallelSort(Data.begin(), Data.end());
+  }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(BM_ParallelSort)->Arg(1 << 16)->Arg(1 << 22);
+
+static void BM_ParallelTransformReduce(benchmark::State &State) {
+  std::vector<uint32_t> Data(State.range(0));
+  for (size_t I = 0; I != Data.size(); ++I)
+    Data[I] = I;
+  for (auto _ : State) {
+    uint64_t Sum = parallelTransformReduce(
+        Data, uint64_t(0), std::plus<uint64_t>(),
+        [](uint32_t X) { return uint64_t(X) * X; });
+    benchmark::DoNotOptimize(Sum);
+  }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(BM_ParallelTransformReduce)->Arg(1024)->Arg(1 << 20);
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  for (int I = 1; I < argc; ++I) {
+    StringRef Arg = argv[I];
+    unsigned Threads;
+    if (!Arg.consume_front("--parallel-threads=") ||
+        Arg.getAsInteger(10, Threads)) {
+      benchmark::ReportUnrecognizedArguments(argc, argv);
+      return 1;
+    }
+    parallel::strategy = hardware_concurrency(Threads);
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
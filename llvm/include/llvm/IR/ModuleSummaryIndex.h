@@ -137,7 +137,11 @@ inline const char *getHotnessName(CalleeInfo::HotnessType HT) {
 
 class GlobalValueSummary;
 
-using GlobalValueSummaryList = std::vector<std::unique_ptr<GlobalValueSummary>>;
+/// Almost all GUIDs have a single summary, so keep it inline. The combined
+/// index of a large link has millions of entries, and a separate allocation
+/// for each list would be a significant part of its memory usage.
+using GlobalValueSummaryList =
+    SmallVector<std::unique_ptr<GlobalValueSummary>, 1>;
 
 struct alignas(8) GlobalValueSummaryInfo {
   union NameOrGV {
@@ -1501,8 +1505,9 @@ private:
 
   GlobalValueSummaryMapTy::value_type *
   getOrInsertValuePtr(GlobalValue::GUID GUID) {
-    return &*GlobalValueMap.emplace(GUID, GlobalValueSummaryInfo(HaveGVs))
-                 .first;
+    // Unlike emplace, try_emplace does not allocate a node if the GUID is
+    // already present, which is the common case when reading summaries.
+    return &*GlobalValueMap.try_emplace(GUID, HaveGVs).first;
   }
 
 public:
@@ -60,13 +60,22 @@ struct CachePruningPolicy {
   /// 4096 and large_dir disabled), there is a per-directory entry limit of
   /// 508*510*floor(4096/(40+8))~=20M for average filename length of 40.
   uint64_t MaxSizeFiles = 1000000;
+
+  /// If true, the size-based and number-of-files-based pruning removes the
+  /// entries that save the least time per byte first, rather than the least
+  /// recently used ones. The time an entry saves is the time it took to
+  /// produce multiplied by the number of times it was used, as recorded by
+  /// localCache(). Entries without a recorded cost are removed first.
+  bool PruneByCost = false;
 };
 
 /// Parse the given string as a cache pruning policy. Defaults are taken from a
 /// default constructed CachePruningPolicy object.
 /// For example: "prune_interval=30s:prune_after=24h:cache_size=50%"
 /// which means a pruning interval of 30 seconds, expiration time of 24 hours
-/// and maximum cache size of 50% of available disk space.
+/// and maximum cache size of 50% of available disk space. "prune_by=cost"
+/// selects CachePruningPolicy::PruneByCost and "prune_by=access_time" the
+/// default least recently used order.
 LLVM_ABI Expected<CachePruningPolicy>
 parseCachePruningPolicy(StringRef PolicyStr);
 
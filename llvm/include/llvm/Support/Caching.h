@@ -17,10 +17,14 @@
 
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
+#include <atomic>
+#include <chrono>
+#include <optional>
 
 namespace llvm {
 
 class MemoryBuffer;
+class raw_ostream;
 
 /// This class wraps an output stream for a file. Most clients should just be
 /// able to return an instance of this base class from the stream callback, but
@@ -66,6 +70,21 @@ using AddStreamFn = std::function<Expected<std::unique_ptr<CachedFileStream>>(
 using FileCacheFunction = std::function<Expected<AddStreamFn>(
     unsigned Task, StringRef Key, const Twine &ModuleName)>;
 
+/// Statistics of a cache created by localCache(). The counters are updated by
+/// concurrent backend threads.
+struct FileCacheStats {
+  std::atomic<uint64_t> Hits{0};
+  std::atomic<uint64_t> Misses{0};
+  /// Time spent producing the entries that missed, in microseconds.
+  std::atomic<uint64_t> MissTimeUs{0};
+  /// Time recorded for the entries that hit, i.e. the time that the cache
+  /// saved, in microseconds. Entries without a recorded cost count as zero.
+  std::atomic<uint64_t> SavedTimeUs{0};
+
+  /// Prints e.g. "3 hits (12.50s saved), 1 miss (4.20s)".
+  LLVM_ABI void print(raw_ostream &OS) const;
+};
+
 /// This type represents a file cache system that manages caching of files.
 /// It encapsulates a caching function and the directory path where the cache is
 /// stored. To request an item from the cache, pass a unique string as the Key.
@@ -83,8 +102,10 @@ using FileCacheFunction = std::function<Expected<AddStreamFn>(
 ///
 /// CacheDirectoryPath stores the directory path where cached files are kept.
 struct FileCache {
-  FileCache(FileCacheFunction CacheFn, const std::string &DirectoryPath)
-      : CacheFunction(std::move(CacheFn)), CacheDirectoryPath(DirectoryPath) {}
+  FileCache(FileCacheFunction CacheFn, const std::string &DirectoryPath,
+            std::shared_ptr<FileCacheStats> Stats = nullptr)
+      : CacheFunction(std::move(CacheFn)), CacheDirectoryPath(DirectoryPath),
+        Stats(std::move(Stats)) {}
   FileCache() = default;
 
   Expected<AddStreamFn> operator()(unsigned Task, StringRef Key,
@@ -96,10 +117,13 @@ struct FileCache {
     return CacheDirectoryPath;
   }
   bool isValid() const { return static_cast<bool>(CacheFunction); }
+  /// Returns the statistics of this cache, or null if it does not keep any.
+  const FileCacheStats *getStats() const { return Stats.get(); }
 
 private:
   FileCacheFunction CacheFunction = nullptr;
   std::string CacheDirectoryPath;
+  std::shared_ptr<FileCacheStats> Stats;
 };
 
 /// This type defines the callback to add a pre-existing file (e.g. in a cache).
@@ -114,11 +138,28 @@ using AddBufferFn = std::function<void(unsigned Task, const Twine &ModuleName,
 /// done lazily the first time a file is added.  The cache name appears in error
 /// messages for errors during caching. The temporary file prefix is used in the
 /// temporary file naming scheme used when writing files atomically.
+///
+/// Next to each entry "llvmcache-<key>", the cache keeps a cost file
+/// "llvmcache.cost-<key>" that records how long the entry took to produce and
+/// how many times it was used, which pruneCache() uses with prune_by=cost.
+/// Several processes may share the directory: cost files are created
+/// atomically like the entries, and each hit appends a single byte, so no
+/// locking is required.
 LLVM_ABI Expected<FileCache> localCache(
     const Twine &CacheNameRef, const Twine &TempFilePrefixRef,
     const Twine &CacheDirectoryPathRef,
     AddBufferFn AddBuffer = [](size_t Task, const Twine &ModuleName,
                                std::unique_ptr<MemoryBuffer> MB) {});
+
+/// The cost recorded for a cache entry by localCache().
+struct CacheEntryCost {
+  std::chrono::microseconds Time;
+  uint64_t Hits;
+};
+
+/// Reads the cost file \p CostPath of a cache entry. Returns std::nullopt if
+/// the file does not exist or is malformed.
+LLVM_ABI std::optional<CacheEntryCost> readCacheEntryCost(const Twine &CostPath);
 } // namespace llvm
 
 #endif
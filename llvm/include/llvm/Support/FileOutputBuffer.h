@@ -34,6 +34,11 @@ public:
 
     /// Use mmap for in-memory file buffer.
     F_mmap = 2,
+
+    /// Open the existing file at the destination path and modify it in
+    /// place instead of atomically replacing it on commit(). Bytes that are
+    /// not written keep their previous values.
+    F_modify = 4,
   };
 
   /// Factory method to create an OutputBuffer object which manages a read/write
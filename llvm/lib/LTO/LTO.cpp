@@ -96,21 +96,11 @@ extern cl::opt<bool> SupportsHotColdNew;
 extern cl::opt<bool> EnableMemProfContextDisambiguation;
 } // namespace llvm
 
-// Computes a unique hash for the Module considering the current list of
-// export/import and other global analysis results.
-// Returns the hash in its hexadecimal representation.
-std::string llvm::computeLTOCacheKey(
-    const Config &Conf, const ModuleSummaryIndex &Index, StringRef ModuleID,
-    const FunctionImporter::ImportMapTy &ImportList,
-    const FunctionImporter::ExportSetTy &ExportList,
-    const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
-    const GVSummaryMapTy &DefinedGlobals,
-    const DenseSet<GlobalValue::GUID> &CfiFunctionDefs,
-    const DenseSet<GlobalValue::GUID> &CfiFunctionDecls) {
-  // Compute the unique hash for this entry.
-  // This is based on the current compiler version, the module itself, the
-  // export list, the hash for every single module in the import list, the
-  // list of ResolvedODR for the module, and the list of preserved symbols.
+// Starts the cache key with the parts that only depend on the compiler and on
+// the LTO configuration, including the contents of the sample profile. The
+// result is the same for all the modules of a link, so the backends compute it
+// once and pass a copy to finishLTOCacheKey for each module.
+static SHA1 hashLTOCacheKeyConfig(const Config &Conf) {
   SHA1 Hasher;
 
   // Start with the compiler revision
@@ -129,14 +119,6 @@ std::string llvm::computeLTOCacheKey(
     support::endian::write32le(Data, I);
     Hasher.update(Data);
   };
-  auto AddUint64 = [&](uint64_t I) {
-    uint8_t Data[8];
-    support::endian::write64le(Data, I);
-    Hasher.update(Data);
-  };
-  auto AddUint8 = [&](const uint8_t I) {
-    Hasher.update(ArrayRef<uint8_t>(&I, 1));
-  };
   AddString(Conf.CPU);
   // FIXME: Hash more of Options. For now all clients initialize Options from
   // command-line flags (which is unsupported in production), but may set
@@ -168,6 +150,50 @@ std::string llvm::computeLTOCacheKey(
   AddString(Conf.DefaultTriple);
   AddString(Conf.DwoDir);
 
+  if (!Conf.SampleProfile.empty()) {
+    auto FileOrErr = MemoryBuffer::getFile(Conf.SampleProfile);
+    if (FileOrErr) {
+      Hasher.update(FileOrErr.get()->getBuffer());
+
+      if (!Conf.ProfileRemapping.empty()) {
+        FileOrErr = MemoryBuffer::getFile(Conf.ProfileRemapping);
+        if (FileOrErr)
+          Hasher.update(FileOrErr.get()->getBuffer());
+      }
+    }
+  }
+
+  return Hasher;
+}
+
+// Completes a cache key started by hashLTOCacheKeyConfig with the parts that
+// depend on the module and on the global analysis results.
+static std::string finishLTOCacheKey(
+    SHA1 Hasher, const ModuleSummaryIndex &Index, StringRef ModuleID,
+    const FunctionImporter::ImportMapTy &ImportList,
+    const FunctionImporter::ExportSetTy &ExportList,
+    const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
+    const GVSummaryMapTy &DefinedGlobals,
+    const DenseSet<GlobalValue::GUID> &CfiFunctionDefs,
+    const DenseSet<GlobalValue::GUID> &CfiFunctionDecls) {
+  auto AddString = [&](StringRef Str) {
+    Hasher.update(Str);
+    Hasher.update(ArrayRef<uint8_t>{0});
+  };
+  auto AddUnsigned = [&](unsigned I) {
+    uint8_t Data[4];
+    support::endian::write32le(Data, I);
+    Hasher.update(Data);
+  };
+  auto AddUint64 = [&](uint64_t I) {
+    uint8_t Data[8];
+    support::endian::write64le(Data, I);
+    Hasher.update(Data);
+  };
+  auto AddUint8 = [&](const uint8_t I) {
+    Hasher.update(ArrayRef<uint8_t>(&I, 1));
+  };
+
   // Include the hash for the current module
   auto ModHash = Index.getModuleHash(ModuleID);
   Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
@@ -333,22 +359,29 @@ std::string llvm::computeLTOCacheKey(
   for (auto &V : UsedCfiDecls)
     AddUint64(V);
 
-  if (!Conf.SampleProfile.empty()) {
-    auto FileOrErr = MemoryBuffer::getFile(Conf.SampleProfile);
-    if (FileOrErr) {
-      Hasher.update(FileOrErr.get()->getBuffer());
-
-      if (!Conf.ProfileRemapping.empty()) {
-        FileOrErr = MemoryBuffer::getFile(Conf.ProfileRemapping);
-        if (FileOrErr)
-          Hasher.update(FileOrErr.get()->getBuffer());
-      }
-    }
-  }
-
   return toHex(Hasher.result());
 }
 
+// Computes a unique hash for the Module considering the current list of
+// export/import and other global analysis results.
+// Returns the hash in its hexadecimal representation.
+std::string llvm::computeLTOCacheKey(
+    const Config &Conf, const ModuleSummaryIndex &Index, StringRef ModuleID,
+    const FunctionImporter::ImportMapTy &ImportList,
+    const FunctionImporter::ExportSetTy &ExportList,
+    const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
+    const GVSummaryMapTy &DefinedGlobals,
+    const DenseSet<GlobalValue::GUID> &CfiFunctionDefs,
+    const DenseSet<GlobalValue::GUID> &CfiFunctionDecls) {
+  // Compute the unique hash for this entry.
+  // This is based on the current compiler version, the module itself, the
+  // export list, the hash for every single module in the import list, the
+  // list of ResolvedODR for the module, and the list of preserved symbols.
+  return finishLTOCacheKey(hashLTOCacheKeyConfig(Conf), Index, ModuleID,
+                           ImportList, ExportList, ResolvedODR, DefinedGlobals,
+                           CfiFunctionDefs, CfiFunctionDecls);
+}
+
 std::string llvm::recomputeLTOCacheKey(const std::string &Key,
                                        StringRef ExtraID) {
   SHA1 Hasher;
@@ -1477,6 +1510,19 @@ public:
 class InProcessThinBackend : public CGThinBackend {
 protected:
   FileCache Cache;
+  /// The part of the cache keys that is common to all modules.
+  SHA1 CacheKeyConfigHasher;
+
+  std::string computeCacheKey(
+      const ModuleSummaryIndex &CombinedIndex, StringRef ModuleID,
+      const FunctionImporter::ImportMapTy &ImportList,
+      const FunctionImporter::ExportSetTy &ExportList,
+      const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
+      const GVSummaryMapTy &DefinedGlobals) const {
+    return finishLTOCacheKey(CacheKeyConfigHasher, CombinedIndex, ModuleID,
+                             ImportList, ExportList, ResolvedODR,
+                             DefinedGlobals, CfiFunctionDefs, CfiFunctionDecls);
+  }
 
 public:
   InProcessThinBackend(
@@ -1488,7 +1534,10 @@ public:
       : CGThinBackend(Conf, CombinedIndex, ModuleToDefinedGVSummaries,
                       AddStream, OnWrite, ShouldEmitIndexFiles,
                       ShouldEmitImportsFiles, ThinLTOParallelism),
-        Cache(std::move(Cache)) {}
+        Cache(std::move(Cache)) {
+    if (this->Cache.isValid())
+      CacheKeyConfigHasher = hashLTOCacheKeyConfig(Conf);
+  }
 
   virtual Error runThinLTOBackendThread(
       AddStreamFn AddStream, FileCache Cache, unsigned Task, BitcodeModule BM,
@@ -1524,9 +1573,8 @@ public:
       return RunThinBackend(AddStream);
 
     // The module may be cached, this helps handling it.
-    std::string Key = computeLTOCacheKey(
-        Conf, CombinedIndex, ModuleID, ImportList, ExportList, ResolvedODR,
-        DefinedGlobals, CfiFunctionDefs, CfiFunctionDecls);
+    std::string Key = computeCacheKey(CombinedIndex, ModuleID, ImportList,
+                                      ExportList, ResolvedODR, DefinedGlobals);
     Expected<AddStreamFn> CacheAddStreamOrErr = Cache(Task, Key, ModuleID);
     if (Error Err = CacheAddStreamOrErr.takeError())
       return Err;
@@ -1642,9 +1690,9 @@ public:
       return RunThinBackend(CGAddStream, IRAddStream);
 
     // Get CGKey for caching object in CGCache.
-    std::string CGKey = computeLTOCacheKey(
-        Conf, CombinedIndex, ModuleID, ImportList, ExportList, ResolvedODR,
-        DefinedGlobals, CfiFunctionDefs, CfiFunctionDecls);
+    std::string CGKey = computeCacheKey(CombinedIndex, ModuleID, ImportList,
+                                        ExportList, ResolvedODR,
+                                        DefinedGlobals);
     Expected<AddStreamFn> CacheCGAddStreamOrErr =
         CGCache(Task, CGKey, ModuleID);
     if (Error Err = CacheCGAddStreamOrErr.takeError())
@@ -1727,9 +1775,8 @@ public:
 
     // Get Key for caching the final object file in Cache with the combined
     // CGData hash.
-    std::string Key = computeLTOCacheKey(
-        Conf, CombinedIndex, ModuleID, ImportList, ExportList, ResolvedODR,
-        DefinedGlobals, CfiFunctionDefs, CfiFunctionDecls);
+    std::string Key = computeCacheKey(CombinedIndex, ModuleID, ImportList,
+                                      ExportList, ResolvedODR, DefinedGlobals);
     Key = recomputeLTOCacheKey(Key,
                                /*ExtraID=*/std::to_string(CombinedCGDataHash));
     Expected<AddStreamFn> CacheAddStreamOrErr = Cache(Task, Key, ModuleID);
@@ -2224,6 +2271,9 @@ class OutOfProcessThinBackend : public CGThinBackend {
     StringRef NativeObjectPath;
     StringRef SummaryIndexPath;
     ImportsFilesContainer ImportsFiles;
+    // The number of IR instructions in the functions defined in and imported
+    // into the module, which the distributor can use to schedule the jobs.
+    uint64_t InstCount;
   };
   // The set of backend compilations jobs.
   SmallVector<Job> Jobs;
@@ -2281,7 +2331,8 @@ public:
         ModulePath,
         Saver.save(ObjFilePath.str()),
         Saver.save(ObjFilePath.str() + ".thinlto.bc"),
-        {} // Filled in by emitFiles below.
+        {}, // Filled in by emitFiles below.
+        0   // Computed below.
     };
 
     assert(ModuleToDefinedGVSummaries.count(ModulePath));
@@ -2289,7 +2340,8 @@ public:
     // The BackendThreadPool is only used here to write the sharded index files
     // (similar to WriteIndexesThinBackend).
     BackendThreadPool.async(
-        [=](Job &J, const FunctionImporter::ImportMapTy &ImportList) {
+        [=](Job &J, const FunctionImporter::ImportMapTy &ImportList,
+            const GVSummaryMapTy &DefinedGlobals) {
           if (auto E = emitFiles(ImportList, J.ModuleID, J.ModuleID.str(),
                                  J.SummaryIndexPath, J.ImportsFiles)) {
             std::unique_lock<std::mutex> L(ErrMu);
@@ -2298,8 +2350,17 @@ public:
             else
               Err = std::move(E);
           }
+          for (const auto &[GUID, S] : DefinedGlobals)
+            if (auto *FS = dyn_cast<FunctionSummary>(S))
+              J.InstCount += FS->instCount();
+          for (const auto &[FromModule, GUID, Type] : ImportList)
+            if (Type == GlobalValueSummary::Definition)
+              if (auto *FS = dyn_cast_or_null<FunctionSummary>(
+                      CombinedIndex.findSummaryInModule(GUID, FromModule)))
+                J.InstCount += FS->instCount();
         },
-        std::ref(J), std::ref(ImportList));
+        std::ref(J), std::ref(ImportList),
+        std::cref(ModuleToDefinedGVSummaries.find(ModulePath)->second));
 
     return Error::success();
   }
@@ -2413,6 +2474,8 @@ public:
             JOS.attribute("inputs", Array(Inputs));
 
             JOS.attribute("outputs", Array(Outputs));
+
+            JOS.attribute("instructions", J.InstCount);
           });
         }
       });
@@ -31,6 +31,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SmallVectorMemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -778,7 +779,9 @@ static Expected<std::vector<MemberData>>
 computeMemberData(raw_ostream &StringTable, raw_ostream &SymNames,
                   object::Archive::Kind Kind, bool Thin, bool Deterministic,
                   SymtabWritingMode NeedSymbols, SymMap *SymMap,
-                  LLVMContext &Context, ArrayRef<NewArchiveMember> NewMembers,
+                  LLVMContext &Context,
+                  std::vector<std::unique_ptr<LLVMContext>> &MemberContexts,
+                  ArrayRef<NewArchiveMember> NewMembers,
                   std::optional<bool> IsEC, function_ref<void(Error)> Warn) {
   static char PaddingData[8] = {'\n', '\n', '\n', '\n', '\n', '\n', '\n', '\n'};
   uint64_t MemHeadPadSize = 0;
@@ -846,15 +849,47 @@ computeMemberData(raw_ostream &StringTable, raw_ostream &SymNames,
   std::vector<std::unique_ptr<SymbolicFile>> SymFiles;
 
   if (NeedSymbols != SymtabWritingMode::NoSymtab || isAIXBigArchive(Kind)) {
-    for (const NewArchiveMember &M : NewMembers) {
+    // The members are read in parallel. An LLVMContext cannot be shared
+    // between threads, so each bitcode member gets its own context; other
+    // members only use Context to tell that bitcode files are symbolic.
+    // Warnings and errors are reported in member order afterwards.
+    SymFiles.resize(NewMembers.size());
+    MemberContexts.resize(NewMembers.size());
+    std::vector<std::optional<Error>> Warnings(NewMembers.size());
+    std::vector<std::optional<Error>> Errors(NewMembers.size());
+    parallelFor(0, NewMembers.size(), [&](size_t I) {
+      MemoryBufferRef Buf = NewMembers[I].Buf->getMemBufferRef();
+      LLVMContext *MemberContext = &Context;
+      if (identify_magic(Buf.getBuffer()) == file_magic::bitcode) {
+        MemberContexts[I] = std::make_unique<LLVMContext>();
+        MemberContext = MemberContexts[I].get();
+      }
       Expected<std::unique_ptr<SymbolicFile>> SymFileOrErr = getSymbolicFile(
-          M.Buf->getMemBufferRef(), Context, Kind, [&](Error Err) {
-            Warn(createFileError(M.MemberName, std::move(Err)));
-          });
-      if (!SymFileOrErr)
-        return createFileError(M.MemberName, SymFileOrErr.takeError());
-      SymFiles.push_back(std::move(*SymFileOrErr));
+          Buf, *MemberContext, Kind,
+          [&](Error Err) { Warnings[I].emplace(std::move(Err)); });
+      if (SymFileOrErr)
+        SymFiles[I] = std::move(*SymFileOrErr);
+      else
+        Errors[I].emplace(SymFileOrErr.takeError());
+    });
+    Error Err = Error::success();
+    for (size_t I = 0, E = NewMembers.size(); I != E; ++I) {
+      StringRef Name = NewMembers[I].MemberName;
+      // Stop at the first error, like reading the members in order would.
+      if (Err) {
+        if (Warnings[I])
+          consumeError(std::move(*Warnings[I]));
+        if (Errors[I])
+          consumeError(std::move(*Errors[I]));
+        continue;
+      }
+      if (Warnings[I])
+        Warn(createFileError(Name, std::move(*Warnings[I])));
+      if (Errors[I])
+        Err = createFileError(Name, std::move(*Errors[I]));
     }
+    if (Err)
+      return std::move(Err);
   }
 
   if (SymMap) {
@@ -1051,10 +1086,12 @@ Error writeArchiveToStream(raw_ostream &Out,
   // In the scenario when LLVMContext is populated SymbolicFile will contain a
   // reference to it, thus SymbolicFile should be destroyed first.
   LLVMContext Context;
+  std::vector<std::unique_ptr<LLVMContext>> MemberContexts;
 
   Expected<std::vector<MemberData>> DataOrErr = computeMemberData(
       StringTable, SymNames, Kind, Thin, Deterministic, WriteSymtab,
-      isCOFFArchive(Kind) ? &SymMap : nullptr, Context, NewMembers, IsEC, Warn);
+      isCOFFArchive(Kind) ? &SymMap : nullptr, Context, MemberContexts,
+      NewMembers, IsEC, Warn);
   if (Error E = DataOrErr.takeError())
     return E;
   std::vector<MemberData> &Data = *DataOrErr;
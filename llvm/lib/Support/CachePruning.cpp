@@ -12,6 +12,7 @@
 
 #include "llvm/Support/CachePruning.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Caching.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
@@ -29,15 +30,19 @@ using namespace llvm;
 
 namespace {
 struct FileInfo {
+  /// Seconds saved per byte with PruneByCost, zero otherwise.
+  double Score;
   sys::TimePoint<> Time;
+  /// The size of the entry and its cost file.
   uint64_t Size;
   std::string Path;
+  std::string CostPath;
 
   /// Used to determine which files to prune first. Also used to determine
   /// set membership, so must take into account all fields.
   bool operator<(const FileInfo &Other) const {
-    return std::tie(Time, Other.Size, Path) <
-           std::tie(Other.Time, Size, Other.Path);
+    return std::tie(Score, Time, Other.Size, Path) <
+           std::tie(Other.Score, Other.Time, Size, Other.Path);
   }
 };
 } // anonymous namespace
@@ -132,6 +137,15 @@ llvm::parseCachePruningPolicy(StringRef PolicyStr) {
       if (Value.getAsInteger(0, Policy.MaxSizeFiles))
         return make_error<StringError>("'" + Value + "' not an integer",
                                        inconvertibleErrorCode());
+    } else if (Key == "prune_by") {
+      if (Value == "cost")
+        Policy.PruneByCost = true;
+      else if (Value == "access_time")
+        Policy.PruneByCost = false;
+      else
+        return make_error<StringError>(
+            "'" + Value + "' must be one of 'cost' or 'access_time'",
+            inconvertibleErrorCode());
     } else {
       return make_error<StringError>("Unknown key: '" + Key + "'",
                                      inconvertibleErrorCode());
@@ -202,9 +216,12 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
   }
 
   // Keep track of files to delete to get below the size limit.
-  // Order by time of last use so that recently used files are preserved.
+  // Order by time of last use so that recently used files are preserved, or
+  // by the time saved per byte with PruneByCost.
   std::set<FileInfo> FileInfos;
   uint64_t TotalSize = 0;
+  // Cost files whose entry may have been removed by an older pruner.
+  std::vector<std::string> CostFiles;
 
   // Walk the entire directory cache, looking for unused files.
   std::error_code EC;
@@ -218,9 +235,19 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
     // This acts as a safeguard against data loss if the user specifies the
     // wrong directory as their cache directory.
     StringRef filename = sys::path::filename(File->path());
+    if (filename.starts_with("llvmcache.cost-")) {
+      CostFiles.push_back(File->path());
+      continue;
+    }
     if (!filename.starts_with("llvmcache-") && !filename.starts_with("Thin-"))
       continue;
 
+    SmallString<128> CostPath;
+    if (filename.consume_front("llvmcache-")) {
+      CostPath = sys::path::parent_path(File->path());
+      sys::path::append(CostPath, "llvmcache.cost-" + filename);
+    }
+
     // Look at this file. If we can't stat it, there's nothing interesting
     // there.
     ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
@@ -237,12 +264,36 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
                         << duration_cast<seconds>(FileAge).count()
                         << "s old)\n");
       sys::fs::remove(File->path());
+      if (!CostPath.empty())
+        sys::fs::remove(CostPath);
       continue;
     }
 
     // Leave it here for now, but add it to the list of size-based pruning.
-    TotalSize += StatusOrErr->getSize();
-    FileInfos.insert({FileAccessTime, StatusOrErr->getSize(), File->path()});
+    uint64_t Size = StatusOrErr->getSize();
+    double Score = 0;
+    if (!CostPath.empty()) {
+      if (std::optional<CacheEntryCost> Cost = readCacheEntryCost(CostPath)) {
+        Size += sizeof(uint64_t) + Cost->Hits;
+        if (Policy.PruneByCost)
+          Score = duration<double>(Cost->Time).count() * (Cost->Hits + 1) /
+                  Size;
+      }
+    }
+    TotalSize += Size;
+    FileInfos.insert({Score, FileAccessTime, Size, File->path(),
+                      std::string(CostPath)});
+  }
+
+  // Remove the cost files of entries that no longer exist. A cost file is
+  // created after its entry, so this does not race with a concurrent link.
+  for (const std::string &CostPath : CostFiles) {
+    StringRef Key = sys::path::filename(CostPath);
+    Key.consume_front("llvmcache.cost-");
+    SmallString<128> EntryPath = sys::path::parent_path(CostPath);
+    sys::path::append(EntryPath, "llvmcache-" + Key);
+    if (!sys::fs::exists(EntryPath))
+      sys::fs::remove(CostPath);
   }
 
   auto FileInfo = FileInfos.begin();
@@ -251,6 +302,8 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
   auto RemoveCacheFile = [&]() {
     // Remove the file.
     sys::fs::remove(FileInfo->Path);
+    if (!FileInfo->CostPath.empty())
+      sys::fs::remove(FileInfo->CostPath);
     // Update size
     TotalSize -= FileInfo->Size;
     NumFiles--;
@@ -311,7 +364,8 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
           << TotalSizeTarget
           << " bytes); consider adjusting --thinlto-cache-policy\n";
 
-    // Remove the oldest accessed files first, till we get below the threshold.
+    // Remove the oldest accessed (or cheapest) files first, till we get below
+    // the threshold.
     while (TotalSize > TotalSizeTarget && FileInfo != FileInfos.end())
       RemoveCacheFile();
   }
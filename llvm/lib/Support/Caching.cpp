@@ -13,10 +13,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Caching.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -26,6 +29,81 @@
 
 using namespace llvm;
 
+// A cost file starts with the time it took to produce the entry, in
+// microseconds, as a 64-bit little-endian integer. Each hit appends one byte.
+static constexpr size_t CostHeaderSize = 8;
+
+void FileCacheStats::print(raw_ostream &OS) const {
+  uint64_t NumHits = Hits, NumMisses = Misses;
+  OS << NumHits << (NumHits == 1 ? " hit" : " hits")
+     << format(" (%.2fs saved), ", SavedTimeUs / 1e6) << NumMisses
+     << (NumMisses == 1 ? " miss" : " misses")
+     << format(" (%.2fs)", MissTimeUs / 1e6);
+}
+
+std::optional<CacheEntryCost> llvm::readCacheEntryCost(const Twine &CostPath) {
+  Expected<sys::fs::file_t> FDOrErr = sys::fs::openNativeFileForRead(CostPath);
+  if (!FDOrErr) {
+    consumeError(FDOrErr.takeError());
+    return std::nullopt;
+  }
+  sys::fs::file_status Status;
+  char Header[CostHeaderSize];
+  std::optional<CacheEntryCost> Cost;
+  Expected<size_t> ReadOrErr = sys::fs::readNativeFile(*FDOrErr, Header);
+  if (!ReadOrErr)
+    consumeError(ReadOrErr.takeError());
+  else if (*ReadOrErr == CostHeaderSize && !sys::fs::status(*FDOrErr, Status))
+    Cost = CacheEntryCost{
+        std::chrono::microseconds(support::endian::read64le(Header)),
+        Status.getSize() - CostHeaderSize};
+  sys::fs::closeFile(*FDOrErr);
+  return Cost;
+}
+
+// Counts a hit in the cost file of an entry and returns the recorded time.
+// Entries written by older versions have no cost file.
+static std::chrono::microseconds recordCacheHit(const Twine &CostPath) {
+  int FD;
+  if (sys::fs::openFileForReadWrite(CostPath, FD, sys::fs::CD_OpenExisting,
+                                    sys::fs::OF_Append))
+    return std::chrono::microseconds(0);
+  char Header[CostHeaderSize];
+  Expected<size_t> ReadOrErr =
+      sys::fs::readNativeFile(sys::fs::convertFDToNativeFile(FD), Header);
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << '\1';
+  if (!ReadOrErr) {
+    consumeError(ReadOrErr.takeError());
+    return std::chrono::microseconds(0);
+  }
+  if (*ReadOrErr != CostHeaderSize)
+    return std::chrono::microseconds(0);
+  return std::chrono::microseconds(support::endian::read64le(Header));
+}
+
+// Creates the cost file of a new entry. The file is renamed into place so that
+// concurrent hits never see a partially written header.
+static void writeCacheEntryCost(StringRef CostPath, StringRef TempFileModel,
+                                std::chrono::microseconds Time) {
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+      TempFileModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+  char Header[CostHeaderSize];
+  support::endian::write64le(Header, Time.count());
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS.write(Header, CostHeaderSize);
+  }
+  if (Error E = Temp->keep(CostPath)) {
+    consumeError(std::move(E));
+    consumeError(Temp->discard());
+  }
+}
+
 Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
                                      const Twine &TempFilePrefixRef,
                                      const Twine &CacheDirectoryPathRef,
@@ -36,6 +114,7 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
   CacheNameRef.toVector(CacheName);
   TempFilePrefixRef.toVector(TempFilePrefix);
   CacheDirectoryPathRef.toVector(CacheDirectoryPath);
+  auto Stats = std::make_shared<FileCacheStats>();
 
   auto Func = [=](unsigned Task, StringRef Key,
                   const Twine &ModuleName) -> Expected<AddStreamFn> {
@@ -43,6 +122,8 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
     // in include/llvm/Support/CachePruning.h).
     SmallString<64> EntryPath;
     sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
+    SmallString<64> CostPath;
+    sys::path::append(CostPath, CacheDirectoryPath, "llvmcache.cost-" + Key);
     // First, see if we have a cache hit.
     SmallString<64> ResultPath;
     Expected<sys::fs::file_t> FDOrErr = sys::fs::openNativeFileForRead(
@@ -56,6 +137,8 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
       sys::fs::closeFile(*FDOrErr);
       if (MBOrErr) {
         AddBuffer(Task, ModuleName, std::move(*MBOrErr));
+        ++Stats->Hits;
+        Stats->SavedTimeUs += recordCacheHit(CostPath).count();
         return AddStreamFn();
       }
       EC = MBOrErr.getError();
@@ -73,6 +156,11 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
       return createStringError(EC, Twine("Failed to open cache file ") +
                                        EntryPath + ": " + EC.message() + "\n");
 
+    // The time from the lookup to the commit is the cost of the entry, which
+    // includes the work done before the stream is requested.
+    ++Stats->Misses;
+    auto Start = std::chrono::steady_clock::now();
+
     // This file stream is responsible for commiting the resulting file to the
     // cache and calling AddBuffer to add it to the link.
     struct CacheStream : CachedFileStream {
@@ -80,13 +168,22 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
       sys::fs::TempFile TempFile;
       std::string ModuleName;
       unsigned Task;
+      std::string CostPath;
+      std::string CostTempFileModel;
+      std::chrono::steady_clock::time_point Start;
+      std::shared_ptr<FileCacheStats> Stats;
 
       CacheStream(std::unique_ptr<raw_pwrite_stream> OS, AddBufferFn AddBuffer,
                   sys::fs::TempFile TempFile, std::string EntryPath,
-                  std::string ModuleName, unsigned Task)
+                  std::string ModuleName, unsigned Task, std::string CostPath,
+                  std::string CostTempFileModel,
+                  std::chrono::steady_clock::time_point Start,
+                  std::shared_ptr<FileCacheStats> Stats)
           : CachedFileStream(std::move(OS), std::move(EntryPath)),
             AddBuffer(std::move(AddBuffer)), TempFile(std::move(TempFile)),
-            ModuleName(ModuleName), Task(Task) {}
+            ModuleName(ModuleName), Task(Task), CostPath(std::move(CostPath)),
+            CostTempFileModel(std::move(CostTempFileModel)), Start(Start),
+            Stats(std::move(Stats)) {}
 
       Error commit() override {
         Error E = CachedFileStream::commit();
@@ -139,6 +236,13 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
         if (E)
           return E;
 
+        // The cost file is written after the entry, so a pruner that finds a
+        // cost file without an entry can remove it.
+        auto Time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - Start);
+        Stats->MissTimeUs += Time.count();
+        writeCacheEntryCost(CostPath, CostTempFileModel, Time);
+
         AddBuffer(Task, ModuleName, std::move(*MBOrErr));
         return Error::success();
       }
@@ -155,9 +259,11 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
                                          EC.message());
 
       // Write to a temporary to avoid race condition
-      SmallString<64> TempFilenameModel;
+      SmallString<64> TempFilenameModel, CostTempFilenameModel;
       sys::path::append(TempFilenameModel, CacheDirectoryPath,
                         TempFilePrefix + "-%%%%%%.tmp.o");
+      sys::path::append(CostTempFilenameModel, CacheDirectoryPath,
+                        TempFilePrefix + "-%%%%%%.tmp.cost");
       Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
           TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
       if (!Temp)
@@ -169,8 +275,9 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
       return std::make_unique<CacheStream>(
           std::make_unique<raw_fd_ostream>(Temp->FD, /* ShouldClose */ false),
           AddBuffer, std::move(*Temp), std::string(EntryPath), ModuleName.str(),
-          Task);
+          Task, std::string(CostPath), std::string(CostTempFilenameModel),
+          Start, Stats);
     };
   };
-  return FileCache(Func, CacheDirectoryPathRef.str());
+  return FileCache(Func, CacheDirectoryPathRef.str(), std::move(Stats));
 }
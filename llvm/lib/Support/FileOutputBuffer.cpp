@@ -11,9 +11,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TimeProfiler.h"
 #include <system_error>
 
@@ -71,6 +73,36 @@ private:
   fs::TempFile Temp;
 };
 
+// A FileOutputBuffer which maps an existing file and modifies it in place.
+// Unlike OnDiskBuffer, the update is not atomic: if the process dies before
+// commit(), the file may be left partially updated.
+class InPlaceBuffer : public FileOutputBuffer {
+public:
+  InPlaceBuffer(StringRef Path, fs::mapped_file_region Buf)
+      : FileOutputBuffer(Path), Buffer(std::move(Buf)) {}
+
+  uint8_t *getBufferStart() const override { return (uint8_t *)Buffer.data(); }
+
+  uint8_t *getBufferEnd() const override {
+    return (uint8_t *)Buffer.data() + Buffer.size();
+  }
+
+  size_t getBufferSize() const override { return Buffer.size(); }
+
+  Error commit() override {
+    llvm::TimeTraceScope timeScope("Commit buffer to disk");
+
+    // Unmap buffer, letting OS flush dirty pages to file on disk.
+    Buffer.unmap();
+    return Error::success();
+  }
+
+  ~InPlaceBuffer() override { Buffer.unmap(); }
+
+private:
+  fs::mapped_file_region Buffer;
+};
+
 // A FileOutputBuffer which keeps data in memory and writes to the final
 // output file on commit(). This is used only when we cannot use OnDiskBuffer.
 class InMemoryBuffer : public FileOutputBuffer {
@@ -154,6 +186,38 @@ createOnDiskBuffer(StringRef Path, size_t Size, unsigned Mode) {
                                          std::move(MappedFile));
 }
 
+static Expected<std::unique_ptr<FileOutputBuffer>>
+createInPlaceBuffer(StringRef Path, size_t Size) {
+  int FD;
+  if (std::error_code EC = fs::openFileForReadWrite(
+          Path, FD, fs::CD_OpenExisting, fs::OF_None))
+    return errorCodeToError(EC);
+  auto CloseFD =
+      make_scope_exit([&] { sys::Process::SafelyCloseFileDescriptor(FD); });
+
+  if (Size == size_t(-1)) {
+    fs::file_status Stat;
+    if (std::error_code EC = fs::status(FD, Stat))
+      return errorCodeToError(EC);
+    Size = Stat.getSize();
+  }
+
+  // If Size is zero, there is nothing to map.
+  if (Size == 0)
+    return errorCodeToError(errc::invalid_argument);
+
+  if (auto EC = fs::resize_file_before_mapping_readwrite(FD, Size))
+    return errorCodeToError(EC);
+
+  std::error_code EC;
+  fs::mapped_file_region MappedFile =
+      fs::mapped_file_region(fs::convertFDToNativeFile(FD),
+                             fs::mapped_file_region::readwrite, Size, 0, EC);
+  if (EC)
+    return errorCodeToError(EC);
+  return std::make_unique<InPlaceBuffer>(Path, std::move(MappedFile));
+}
+
 // Create an instance of FileOutputBuffer.
 Expected<std::unique_ptr<FileOutputBuffer>>
 FileOutputBuffer::create(StringRef Path, size_t Size, unsigned Flags) {
@@ -161,6 +225,9 @@ FileOutputBuffer::create(StringRef Path, size_t Size, unsigned Flags) {
   if (Path == "-")
     return createInMemoryBuffer("-", Size, /*Mode=*/0);
 
+  if (Flags & F_modify)
+    return createInPlaceBuffer(Path, Size);
+
   unsigned Mode = fs::all_read | fs::all_write;
   if (Flags & F_executable)
     Mode |= fs::all_exe;
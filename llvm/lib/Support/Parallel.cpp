@@ -12,6 +12,7 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
+#include <deque>
 #include <future>
 #include <thread>
 #include <vector>
@@ -44,12 +45,19 @@ public:
   static Executor *getDefaultExecutor();
 };
 
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+/// An implementation of an Executor that runs closures on a thread pool with
+/// work stealing. Each worker owns a queue. A task added by a worker goes to
+/// the worker's own queue, which it runs in filo order; tasks added by other
+/// threads are distributed over the queues round-robin. A worker whose queue
+/// is empty steals the oldest task of another queue, trying the workers with
+/// the nearest indices first, as those are the most likely to share a cache
+/// or NUMA node. Compared to a single shared queue, this avoids contention on
+/// one mutex when there are many threads.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(ThreadPoolStrategy S) {
     ThreadCount = S.compute_thread_count();
+    Queues = std::make_unique<WorkQueue[]>(ThreadCount);
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     Threads.reserve(ThreadCount);
@@ -98,33 +106,97 @@ public:
   };
 
   void add(std::function<void()> F) override {
-    {
-      std::lock_guard<std::mutex> Lock(Mutex);
-      WorkStack.push_back(std::move(F));
-    }
+    unsigned I = threadIndex < ThreadCount
+                     ? threadIndex
+                     : NextQueue.fetch_add(1, std::memory_order_relaxed) %
+                           ThreadCount;
+    Queues[I].push(std::move(F));
+
+    // A worker goes to sleep only after incrementing NumSleeping and seeing
+    // NumPending == 0, so either it sees the new task or we see the worker.
+    ++NumPending;
+    if (NumSleeping == 0)
+      return;
+    { std::lock_guard<std::mutex> Lock(Mutex); }
     Cond.notify_one();
   }
 
   size_t getThreadCount() const override { return ThreadCount; }
 
 private:
+  struct alignas(64) WorkQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+    // The number of tasks, readable without the lock.
+    std::atomic<size_t> Size{0};
+
+    void push(std::function<void()> F) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Tasks.push_back(std::move(F));
+      Size.store(Tasks.size(), std::memory_order_relaxed);
+    }
+
+    bool pop(std::function<void()> &F, bool Newest) {
+      if (Size.load(std::memory_order_relaxed) == 0)
+        return false;
+      std::lock_guard<std::mutex> Lock(Mutex);
+      if (Tasks.empty())
+        return false;
+      if (Newest) {
+        F = std::move(Tasks.back());
+        Tasks.pop_back();
+      } else {
+        F = std::move(Tasks.front());
+        Tasks.pop_front();
+      }
+      Size.store(Tasks.size(), std::memory_order_relaxed);
+      return true;
+    }
+  };
+
+  // Takes the newest task of the worker's own queue or steals the oldest task
+  // of another queue, visiting the workers ThreadID+1, ThreadID-1,
+  // ThreadID+2, ... in turn.
+  bool take(unsigned ThreadID, std::function<void()> &F) {
+    if (Queues[ThreadID].pop(F, /*Newest=*/true))
+      return true;
+    for (unsigned D = 1; D < ThreadCount; ++D) {
+      unsigned Distance = (D + 1) / 2;
+      unsigned Victim = D % 2 ? ThreadID + Distance
+                              : ThreadID + ThreadCount - Distance;
+      Victim %= ThreadCount;
+      if (Queues[Victim].pop(F, /*Newest=*/false))
+        return true;
+    }
+    return false;
+  }
+
   void work(ThreadPoolStrategy S, unsigned ThreadID) {
     threadIndex = ThreadID;
     S.apply_thread_strategy(ThreadID);
-    while (true) {
+    std::function<void()> Task;
+    while (!Stop) {
+      if (take(ThreadID, Task)) {
+        --NumPending;
+        Task();
+        Task = nullptr;
+        continue;
+      }
       std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
-      if (Stop)
-        break;
-      auto Task = std::move(WorkStack.back());
-      WorkStack.pop_back();
-      Lock.unlock();
-      Task();
+      ++NumSleeping;
+      Cond.wait(Lock, [&] { return Stop || NumPending != 0; });
+      --NumSleeping;
     }
   }
 
   std::atomic<bool> Stop{false};
-  std::vector<std::function<void()>> WorkStack;
+  std::unique_ptr<WorkQueue[]> Queues;
+  // The queue of the next task added by a thread that is not a worker.
+  std::atomic<unsigned> NextQueue{0};
+  // The number of tasks in all queues.
+  std::atomic<size_t> NumPending{0};
+  // The number of workers waiting on Cond.
+  std::atomic<unsigned> NumSleeping{0};
   std::mutex Mutex;
   std::condition_variable Cond;
   std::promise<void> ThreadsCreated;
@@ -211,28 +283,30 @@ void TaskGroup::spawn(std::function<void()> F) {
 void llvm::parallelFor(size_t Begin, size_t End,
                        llvm::function_ref<void(size_t)> Fn) {
 #if LLVM_ENABLE_THREADS
-  if (parallel::strategy.ThreadsRequested != 1) {
-    auto NumItems = End - Begin;
-    // Limit the number of tasks to MaxTasksPerGroup to limit job scheduling
-    // overhead on large inputs.
-    auto TaskSize = NumItems / parallel::detail::MaxTasksPerGroup;
-    if (TaskSize == 0)
-      TaskSize = 1;
-
+  if (parallel::strategy.ThreadsRequested != 1 && End - Begin > 1) {
+    std::atomic<size_t> Next{Begin};
     parallel::TaskGroup TG;
-    for (; Begin + TaskSize < End; Begin += TaskSize) {
-      TG.spawn([=, &Fn] {
-        for (size_t I = Begin, E = Begin + TaskSize; I != E; ++I)
-          Fn(I);
-      });
+    if (TG.isParallel()) {
+      // Spawn one task per thread rather than one per chunk. Each task claims
+      // chunks of the remaining items until none are left. The chunks shrink
+      // as the loop nears its end, so threads that finish early take over the
+      // work of slow ones without paying for many small chunks up front.
+      size_t NumTasks = std::min(End - Begin, parallel::getThreadCount());
+      auto Body = [=, &Next, &Fn] {
+        for (;;) {
+          size_t Cur = Next.load(std::memory_order_relaxed);
+          if (Cur >= End)
+            return;
+          size_t ChunkSize = std::max<size_t>(1, (End - Cur) / (NumTasks * 4));
+          size_t I = Next.fetch_add(ChunkSize, std::memory_order_relaxed);
+          for (size_t E = std::min(I + ChunkSize, End); I < E; ++I)
+            Fn(I);
+        }
+      };
+      for (size_t I = 0; I != NumTasks; ++I)
+        TG.spawn(Body);
+      return;
     }
-    if (Begin != End) {
-      TG.spawn([=, &Fn] {
-        for (size_t I = Begin; I != End; ++I)
-          Fn(I);
-      });
-    }
-    return;
   }
 #endif
 
@@ -38,6 +38,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
@@ -45,6 +46,7 @@
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
+#include <atomic>
 #include <cassert>
 #include <memory>
 #include <string>
@@ -388,6 +390,11 @@ FunctionImporter::ImportMapTy::getImportType(StringRef FromModule,
   return std::nullopt;
 }
 
+/// The values that the imports into one module export from other modules, as
+/// pairs of exporting module and value in the order they were found. They are
+/// added to the export lists once the imports of all modules are computed.
+using ExportsOfImportsTy = SmallVectorImpl<std::pair<StringRef, ValueInfo>>;
+
 /// Import globals referenced by a function or other globals that are being
 /// imported, if importing such global is possible.
 class GlobalsImporter final {
@@ -396,7 +403,7 @@ class GlobalsImporter final {
   function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
       IsPrevailing;
   FunctionImporter::ImportMapTy &ImportList;
-  DenseMap<StringRef, FunctionImporter::ExportSetTy> *const ExportLists;
+  ExportsOfImportsTy *const Exports;
 
   bool shouldImportGlobal(const ValueInfo &VI) {
     const auto &GVS = DefinedGVSummaries.find(VI.getGUID());
@@ -464,8 +471,8 @@ class GlobalsImporter final {
         // Any references made by this variable will be marked exported
         // later, in ComputeCrossModuleImport, after import decisions are
         // complete, which is more efficient than adding them here.
-        if (ExportLists)
-          (*ExportLists)[RefSummary->modulePath()].insert(VI);
+        if (Exports)
+          Exports->emplace_back(RefSummary->modulePath(), VI);
 
         // If variable is not writeonly we attempt to recursively analyze
         // its references in order to import referenced constants.
@@ -481,11 +488,9 @@ public:
       const ModuleSummaryIndex &Index, const GVSummaryMapTy &DefinedGVSummaries,
       function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
           IsPrevailing,
-      FunctionImporter::ImportMapTy &ImportList,
-      DenseMap<StringRef, FunctionImporter::ExportSetTy> *ExportLists)
+      FunctionImporter::ImportMapTy &ImportList, ExportsOfImportsTy *Exports)
       : Index(Index), DefinedGVSummaries(DefinedGVSummaries),
-        IsPrevailing(IsPrevailing), ImportList(ImportList),
-        ExportLists(ExportLists) {}
+        IsPrevailing(IsPrevailing), ImportList(ImportList), Exports(Exports) {}
 
   void onImportingSummary(const GlobalValueSummary &Summary) {
     SmallVector<const GlobalVarSummary *, 128> Worklist;
@@ -497,27 +502,27 @@ public:
 
 static const char *getFailureName(FunctionImporter::ImportFailureReason Reason);
 
-/// Determine the list of imports and exports for each module.
+/// Determine the list of imports and exports for each module. The manager is
+/// not modified by computeImportForModule(), so the imports of several modules
+/// can be computed in parallel.
 class ModuleImportsManager {
   void computeImportForFunction(
       const FunctionSummary &Summary, unsigned Threshold,
       const GVSummaryMapTy &DefinedGVSummaries,
       SmallVectorImpl<EdgeInfo> &Worklist, GlobalsImporter &GVImporter,
-      FunctionImporter::ImportMapTy &ImportList,
+      FunctionImporter::ImportMapTy &ImportList, ExportsOfImportsTy *Exports,
       FunctionImporter::ImportThresholdsTy &ImportThresholds);
 
 protected:
   function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
       IsPrevailing;
   const ModuleSummaryIndex &Index;
-  DenseMap<StringRef, FunctionImporter::ExportSetTy> *const ExportLists;
 
   ModuleImportsManager(
       function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
           IsPrevailing,
-      const ModuleSummaryIndex &Index,
-      DenseMap<StringRef, FunctionImporter::ExportSetTy> *ExportLists = nullptr)
-      : IsPrevailing(IsPrevailing), Index(Index), ExportLists(ExportLists) {}
+      const ModuleSummaryIndex &Index)
+      : IsPrevailing(IsPrevailing), Index(Index) {}
   virtual bool canImport(ValueInfo VI) { return true; }
 
 public:
@@ -525,18 +530,18 @@ public:
 
   /// Given the list of globals defined in a module, compute the list of imports
   /// as well as the list of "exports", i.e. the list of symbols referenced from
-  /// another module (that may require promotion).
+  /// another module (that may require promotion). \p Exports may be null if
+  /// the exports are not needed.
   virtual void
   computeImportForModule(const GVSummaryMapTy &DefinedGVSummaries,
                          StringRef ModName,
-                         FunctionImporter::ImportMapTy &ImportList);
+                         FunctionImporter::ImportMapTy &ImportList,
+                         ExportsOfImportsTy *Exports);
 
   static std::unique_ptr<ModuleImportsManager>
   create(function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
              IsPrevailing,
-         const ModuleSummaryIndex &Index,
-         DenseMap<StringRef, FunctionImporter::ExportSetTy> *ExportLists =
-             nullptr);
+         const ModuleSummaryIndex &Index);
 };
 
 /// A ModuleImportsManager that operates based on a workload definition (see
@@ -556,7 +561,8 @@ class WorkloadImportsManager : public ModuleImportsManager {
   void
   computeImportForModule(const GVSummaryMapTy &DefinedGVSummaries,
                          StringRef ModName,
-                         FunctionImporter::ImportMapTy &ImportList) override {
+                         FunctionImporter::ImportMapTy &ImportList,
+                         ExportsOfImportsTy *Exports) override {
     StringRef Filename = ModName;
     if (CtxprofMoveRootsToOwnModule) {
       Filename = sys::path::filename(ModName);
@@ -568,14 +574,14 @@ class WorkloadImportsManager : public ModuleImportsManager {
     if (SetIter == Workloads.end()) {
       LLVM_DEBUG(dbgs() << "[Workload] " << ModName
                         << " does not contain the root of any context.\n");
-      return ModuleImportsManager::computeImportForModule(DefinedGVSummaries,
-                                                          ModName, ImportList);
+      return ModuleImportsManager::computeImportForModule(
+          DefinedGVSummaries, ModName, ImportList, Exports);
     }
     LLVM_DEBUG(dbgs() << "[Workload] " << ModName
                       << " contains the root(s) of context(s).\n");
 
     GlobalsImporter GVI(Index, DefinedGVSummaries, IsPrevailing, ImportList,
-                        ExportLists);
+                        Exports);
     auto &ValueInfos = SetIter->second;
     for (auto &VI : llvm::make_early_inc_range(ValueInfos)) {
       auto It = DefinedGVSummaries.find(VI.getGUID());
@@ -662,8 +668,8 @@ class WorkloadImportsManager : public ModuleImportsManager {
                         << ExportingModule << " : " << VI.getGUID() << "\n");
       ImportList.addDefinition(ExportingModule, VI.getGUID());
       GVI.onImportingSummary(*GVS);
-      if (ExportLists)
-        (*ExportLists)[ExportingModule].insert(VI);
+      if (Exports)
+        Exports->emplace_back(ExportingModule, VI);
     }
     LLVM_DEBUG(dbgs() << "[Workload] Done\n");
   }
@@ -802,9 +808,8 @@ public:
   WorkloadImportsManager(
       function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
           IsPrevailing,
-      const ModuleSummaryIndex &Index,
-      DenseMap<StringRef, FunctionImporter::ExportSetTy> *ExportLists)
-      : ModuleImportsManager(IsPrevailing, Index, ExportLists) {
+      const ModuleSummaryIndex &Index)
+      : ModuleImportsManager(IsPrevailing, Index) {
     if (UseCtxProfile.empty() == WorkloadDefinitions.empty()) {
       report_fatal_error(
           "Pass only one of: -thinlto-pgo-ctx-prof or -thinlto-workload-def");
@@ -830,16 +835,14 @@ public:
 std::unique_ptr<ModuleImportsManager> ModuleImportsManager::create(
     function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
         IsPrevailing,
-    const ModuleSummaryIndex &Index,
-    DenseMap<StringRef, FunctionImporter::ExportSetTy> *ExportLists) {
+    const ModuleSummaryIndex &Index) {
   if (WorkloadDefinitions.empty() && UseCtxProfile.empty()) {
     LLVM_DEBUG(dbgs() << "[Workload] Using the regular imports manager.\n");
     return std::unique_ptr<ModuleImportsManager>(
-        new ModuleImportsManager(IsPrevailing, Index, ExportLists));
+        new ModuleImportsManager(IsPrevailing, Index));
   }
   LLVM_DEBUG(dbgs() << "[Workload] Using the contextual imports manager.\n");
-  return std::make_unique<WorkloadImportsManager>(IsPrevailing, Index,
-                                                  ExportLists);
+  return std::make_unique<WorkloadImportsManager>(IsPrevailing, Index);
 }
 
 static const char *
@@ -872,10 +875,10 @@ void ModuleImportsManager::computeImportForFunction(
     const FunctionSummary &Summary, const unsigned Threshold,
     const GVSummaryMapTy &DefinedGVSummaries,
     SmallVectorImpl<EdgeInfo> &Worklist, GlobalsImporter &GVImporter,
-    FunctionImporter::ImportMapTy &ImportList,
+    FunctionImporter::ImportMapTy &ImportList, ExportsOfImportsTy *Exports,
     FunctionImporter::ImportThresholdsTy &ImportThresholds) {
   GVImporter.onImportingSummary(Summary);
-  static int ImportCount = 0;
+  static std::atomic<int> ImportCount = 0;
   for (const auto &Edge : Summary.calls()) {
     ValueInfo VI = Edge.first;
     LLVM_DEBUG(dbgs() << " edge -> " << VI << " Threshold:" << Threshold
@@ -973,7 +976,7 @@ void ModuleImportsManager::computeImportForFunction(
         if (ImportDeclaration && SummaryForDeclImport) {
           StringRef DeclSourceModule = SummaryForDeclImport->modulePath();
 
-          // Note `ExportLists` only keeps track of exports due to imported
+          // Note `Exports` only keeps track of exports due to imported
           // definitions.
           ImportList.maybeAddDeclaration(DeclSourceModule, VI.getGUID());
         }
@@ -1036,8 +1039,8 @@ void ModuleImportsManager::computeImportForFunction(
       // Any calls/references made by this function will be marked exported
       // later, in ComputeCrossModuleImport, after import decisions are
       // complete, which is more efficient than adding them here.
-      if (ExportLists)
-        (*ExportLists)[ExportModulePath].insert(VI);
+      if (Exports)
+        Exports->emplace_back(ExportModulePath, VI);
     }
 
     auto GetAdjustedThreshold = [](unsigned Threshold, bool IsHotCallsite) {
@@ -1060,12 +1063,12 @@ void ModuleImportsManager::computeImportForFunction(
 
 void ModuleImportsManager::computeImportForModule(
     const GVSummaryMapTy &DefinedGVSummaries, StringRef ModName,
-    FunctionImporter::ImportMapTy &ImportList) {
+    FunctionImporter::ImportMapTy &ImportList, ExportsOfImportsTy *Exports) {
   // Worklist contains the list of function imported in this module, for which
   // we will analyse the callees and may import further down the callgraph.
   SmallVector<EdgeInfo, 128> Worklist;
   GlobalsImporter GVI(Index, DefinedGVSummaries, IsPrevailing, ImportList,
-                      ExportLists);
+                      Exports);
   FunctionImporter::ImportThresholdsTy ImportThresholds;
 
   // Populate the worklist with the import for the functions in the current
@@ -1087,7 +1090,8 @@ void ModuleImportsManager::computeImportForModule(
       continue;
     LLVM_DEBUG(dbgs() << "Initialize import for " << VI << "\n");
     computeImportForFunction(*FuncSummary, ImportInstrLimit, DefinedGVSummaries,
-                             Worklist, GVI, ImportList, ImportThresholds);
+                             Worklist, GVI, ImportList, Exports,
+                             ImportThresholds);
   }
 
   // Process the newly imported functions and add callees to the worklist.
@@ -1098,7 +1102,7 @@ void ModuleImportsManager::computeImportForModule(
 
     if (auto *FS = dyn_cast<FunctionSummary>(Summary))
       computeImportForFunction(*FS, Threshold, DefinedGVSummaries, Worklist,
-                               GVI, ImportList, ImportThresholds);
+                               GVI, ImportList, Exports, ImportThresholds);
   }
 
   // Print stats about functions considered but rejected for importing
@@ -1221,28 +1225,76 @@ void llvm::ComputeCrossModuleImport(
         isPrevailing,
     FunctionImporter::ImportListsTy &ImportLists,
     DenseMap<StringRef, FunctionImporter::ExportSetTy> &ExportLists) {
-  auto MIS = ModuleImportsManager::create(isPrevailing, Index, &ExportLists);
-  // For each module that has function defined, compute the import/export lists.
-  for (const auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportList = ImportLists[DefinedGVSummaries.first];
-    LLVM_DEBUG(dbgs() << "Computing import for Module '"
-                      << DefinedGVSummaries.first << "'\n");
-    MIS->computeImportForModule(DefinedGVSummaries.second,
-                                DefinedGVSummaries.first, ImportList);
+  auto MIS = ModuleImportsManager::create(isPrevailing, Index);
+
+  // The imports of each module only depend on the index, so they are computed
+  // in parallel into lists that are private to each module. The lists are then
+  // merged in the iteration order of ModuleToDefinedGVSummaries, which keeps
+  // the import IDs and the export lists independent of the number of threads.
+  // -import-cutoff counts the imports across modules and
+  // -print-import-failures and -debug write to dbgs(), so they process one
+  // module at a time.
+  struct ModuleImports {
+    FunctionImporter::ImportIDTable IDs;
+    FunctionImporter::ImportMapTy ImportList{IDs};
+    SmallVector<std::pair<StringRef, ValueInfo>, 0> Exports;
+  };
+  SmallVector<std::pair<StringRef, const GVSummaryMapTy *>, 0> Modules;
+  for (const auto &DefinedGVSummaries : ModuleToDefinedGVSummaries)
+    Modules.emplace_back(DefinedGVSummaries.first, &DefinedGVSummaries.second);
+
+  bool Serial = ImportCutoff >= 0 || PrintImportFailures;
+#ifndef NDEBUG
+  Serial |= DebugFlag;
+#endif
+
+  // Bound the memory used by the private lists.
+  const size_t BatchSize = 1024;
+  std::vector<std::unique_ptr<ModuleImports>> Batch(BatchSize);
+  for (size_t Begin = 0; Begin < Modules.size(); Begin += BatchSize) {
+    size_t End = std::min(Begin + BatchSize, Modules.size());
+    auto Compute = [&](size_t I) {
+      auto &[ModName, DefinedGVSummaries] = Modules[I];
+      LLVM_DEBUG(dbgs() << "Computing import for Module '" << ModName
+                        << "'\n");
+      auto &MI = Batch[I - Begin];
+      MI = std::make_unique<ModuleImports>();
+      MIS->computeImportForModule(*DefinedGVSummaries, ModName, MI->ImportList,
+                                  &MI->Exports);
+    };
+    if (Serial)
+      for (size_t I = Begin; I != End; ++I)
+        Compute(I);
+    else
+      parallelFor(Begin, End, Compute);
+
+    for (size_t I = Begin; I != End; ++I) {
+      std::unique_ptr<ModuleImports> MI = std::move(Batch[I - Begin]);
+      auto &ImportList = ImportLists[Modules[I].first];
+      for (const auto &[FromModule, GUID, Type] : MI->ImportList)
+        ImportList.addGUID(FromModule, GUID, Type);
+      for (const auto &[ExportModulePath, VI] : MI->Exports)
+        ExportLists[ExportModulePath].insert(VI);
+    }
   }
 
   // When computing imports we only added the variables and functions being
   // imported to the export list. We also need to mark any references and calls
   // they make as exported as well. We do this here, as it is more efficient
   // since we may import the same values multiple times into different modules
-  // during the import computation.
-  for (auto &ELI : ExportLists) {
+  // during the import computation. Each export list is extended independently,
+  // so this is done in parallel as well.
+  SmallVector<std::pair<StringRef, FunctionImporter::ExportSetTy *>, 0>
+      ExportSets;
+  for (auto &ELI : ExportLists)
+    ExportSets.emplace_back(ELI.first, &ELI.second);
+  parallelFor(0, ExportSets.size(), [&](size_t I) {
+    auto &[ModName, ExportSet] = ExportSets[I];
     // `NewExports` tracks the VI that gets exported because the full definition
     // of its user/referencer gets exported.
     FunctionImporter::ExportSetTy NewExports;
-    const auto &DefinedGVSummaries =
-        ModuleToDefinedGVSummaries.lookup(ELI.first);
-    for (auto &EI : ELI.second) {
+    const auto &DefinedGVSummaries = ModuleToDefinedGVSummaries.lookup(ModName);
+    for (auto &EI : *ExportSet) {
       // Find the copy defined in the exporting module so that we can mark the
       // values it references in that specific definition as exported.
       // Below we will add all references and called values, without regard to
@@ -1278,8 +1330,8 @@ void llvm::ComputeCrossModuleImport(
       else
         ++EI;
     }
-    ELI.second.insert_range(NewExports);
-  }
+    ExportSet->insert_range(NewExports);
+  });
 
   assert(checkVariableImport(Index, ImportLists, ExportLists));
 #ifndef NDEBUG
@@ -1350,7 +1402,8 @@ static void ComputeCrossModuleImportForModuleForTest(
   // Compute the import list for this module.
   LLVM_DEBUG(dbgs() << "Computing import for Module '" << ModulePath << "'\n");
   auto MIS = ModuleImportsManager::create(isPrevailing, Index);
-  MIS->computeImportForModule(FunctionSummaryMap, ModulePath, ImportList);
+  MIS->computeImportForModule(FunctionSummaryMap, ModulePath, ImportList,
+                              /*Exports=*/nullptr);
 
 #ifndef NDEBUG
   dumpImportListForModule(Index, ModulePath, ImportList);
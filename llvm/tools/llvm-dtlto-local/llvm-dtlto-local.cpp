@@ -0,0 +1,266 @@
+//===- llvm-dtlto-local.cpp - Local distributor for distributed ThinLTO ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This program is a distributor for the out-of-process ThinLTO backend (see
+// lto::createOutOfProcessThinBackend) that runs the backend compilations on the
+// local machine. It is invoked by the linker with the path of a JSON file that
+// describes the compilations, e.g. with
+// --thinlto-distributor=llvm-dtlto-local.
+//
+// Unlike a generic job runner, it uses the number of IR instructions recorded
+// for each job to start the largest jobs first, so that a large module does
+// not end up compiling alone at the end of the link, and to estimate the peak
+// memory usage of each job, so that the total stays under --memory-limit. The
+// estimate is refined with the peak memory usage of the jobs that have
+// finished.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::OptionCategory DistributorCategory("llvm-dtlto-local Options");
+
+static cl::opt<std::string> JsonFilename(cl::Positional, cl::Required,
+                                         cl::desc("<distributor JSON file>"),
+                                         cl::cat(DistributorCategory));
+
+static cl::opt<unsigned>
+    Jobs("j", cl::desc("Number of compilations to run in parallel "
+                       "(default: all hardware threads)"),
+         cl::init(0), cl::cat(DistributorCategory));
+
+static cl::opt<uint64_t> MemoryLimit(
+    "memory-limit",
+    cl::desc("Limit on the estimated total memory usage of the running "
+             "compilations, in MiB (default: no limit)"),
+    cl::init(0), cl::cat(DistributorCategory));
+
+static cl::opt<std::string>
+    ReportFilename("report",
+                   cl::desc("Write the time and peak memory usage of each "
+                            "compilation to <file> as tab-separated values"),
+                   cl::value_desc("file"), cl::cat(DistributorCategory));
+
+namespace {
+struct Job {
+  SmallVector<StringRef, 0> Args;
+  StringRef ModuleID;
+  uint64_t InstCount;
+  uint64_t EstimatedKiB = 0;
+
+  // Filled in when the job finishes.
+  bool Succeeded = false;
+  std::chrono::milliseconds WallTime{0};
+  std::optional<sys::ProcessStatistics> Stats;
+};
+
+/// Hands out jobs, largest first, to the worker threads. A job is started only
+/// if the estimated memory usage of the running jobs and the job stays under
+/// the limit, or if no other job is running. Jobs are not started out of
+/// order, so that the largest jobs are not starved by smaller ones.
+class Scheduler {
+public:
+  Scheduler(MutableArrayRef<Job> Jobs, uint64_t LimitKiB)
+      : Jobs(Jobs), LimitKiB(LimitKiB) {}
+
+  /// Returns the next job to run, or null if there is none left.
+  Job *acquire() {
+    std::unique_lock<std::mutex> Lock(Mu);
+    for (;;) {
+      if (Next == Jobs.size() || Failed)
+        return nullptr;
+      Job &J = Jobs[Next];
+      uint64_t Estimate = estimate(J);
+      if (Running == 0 || !LimitKiB || InFlightKiB + Estimate <= LimitKiB) {
+        ++Next;
+        ++Running;
+        J.EstimatedKiB = Estimate;
+        InFlightKiB += Estimate;
+        return &J;
+      }
+      CV.wait(Lock);
+    }
+  }
+
+  void release(Job &J, bool Succeeded) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    --Running;
+    InFlightKiB -= J.EstimatedKiB;
+    Failed |= !Succeeded;
+    // Keep the model conservative: a job that needed more memory than
+    // estimated raises the estimate of all remaining jobs.
+    if (J.Stats)
+      KiBPerInst = std::max(KiBPerInst, double(J.Stats->PeakMemory) /
+                                            (J.InstCount + OverheadInsts));
+    CV.notify_all();
+  }
+
+private:
+  // The memory usage of a compilation is modeled as proportional to the
+  // number of instructions plus a fixed overhead for the compiler itself,
+  // expressed in instructions. The initial estimate is 128 MiB for an empty
+  // module and 2 KiB per instruction.
+  static constexpr uint64_t OverheadInsts = 64 * 1024;
+
+  uint64_t estimate(const Job &J) const {
+    return KiBPerInst * (J.InstCount + OverheadInsts);
+  }
+
+  MutableArrayRef<Job> Jobs;
+  uint64_t LimitKiB;
+  std::mutex Mu;
+  std::condition_variable CV;
+  size_t Next = 0;
+  unsigned Running = 0;
+  uint64_t InFlightKiB = 0;
+  double KiBPerInst = 2;
+  bool Failed = false;
+};
+} // namespace
+
+static void runJob(StringRef Program, Job &J, Scheduler &S) {
+  std::string ErrMsg;
+  auto Start = std::chrono::steady_clock::now();
+  int Ret = sys::ExecuteAndWait(Program, J.Args, /*Env=*/std::nullopt,
+                                /*Redirects=*/{}, /*SecondsToWait=*/0,
+                                /*MemoryLimit=*/0, &ErrMsg,
+                                /*ExecutionFailed=*/nullptr, &J.Stats);
+  J.WallTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - Start);
+  J.Succeeded = Ret == 0;
+  if (!J.Succeeded)
+    WithColor::error(errs(), "llvm-dtlto-local")
+        << "backend compilation of " << J.ModuleID << " failed"
+        << (ErrMsg.empty() ? ": exit code " + std::to_string(Ret)
+                           : ": " + ErrMsg)
+        << "\n";
+  S.release(J, J.Succeeded);
+}
+
+static Error writeReport(StringRef Path, ArrayRef<Job> Jobs) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::OF_TextWithCRLF);
+  if (EC)
+    return createFileError(Path, EC);
+  OS << "module\tinstructions\testimated_kib\tpeak_kib\twall_ms\tcpu_ms\n";
+  for (const Job &J : Jobs) {
+    if (!J.Stats)
+      continue;
+    OS << J.ModuleID << '\t' << J.InstCount << '\t' << J.EstimatedKiB << '\t'
+       << J.Stats->PeakMemory << '\t' << J.WallTime.count() << '\t'
+       << std::chrono::duration_cast<std::chrono::milliseconds>(
+              J.Stats->TotalTime)
+              .count()
+       << '\n';
+  }
+  return Error::success();
+}
+
+static Expected<std::vector<Job>> readJobs(const json::Object &Root,
+                                           SmallVectorImpl<StringRef> &Common) {
+  auto Malformed = [](const Twine &Msg) {
+    return createStringError(inconvertibleErrorCode(),
+                             "malformed distributor JSON: " + Msg);
+  };
+  auto AppendStrings = [](const json::Array &Arr,
+                          SmallVectorImpl<StringRef> &Out) {
+    for (const json::Value &V : Arr) {
+      std::optional<StringRef> S = V.getAsString();
+      if (!S)
+        return false;
+      Out.push_back(*S);
+    }
+    return true;
+  };
+
+  const json::Object *CommonObj = Root.getObject("common");
+  const json::Array *CommonArgs = CommonObj ? CommonObj->getArray("args")
+                                            : nullptr;
+  if (!CommonArgs || !AppendStrings(*CommonArgs, Common) || Common.empty())
+    return Malformed("expected a non-empty array of strings in common.args");
+
+  const json::Array *JobArr = Root.getArray("jobs");
+  if (!JobArr)
+    return Malformed("expected an array in jobs");
+  std::vector<Job> Jobs(JobArr->size());
+  for (auto [J, V] : zip(Jobs, *JobArr)) {
+    const json::Object *Obj = V.getAsObject();
+    const json::Array *Args = Obj ? Obj->getArray("args") : nullptr;
+    J.Args.assign(Common.begin(), Common.end());
+    if (!Args || Args->empty() || !AppendStrings(*Args, J.Args))
+      return Malformed("expected a non-empty array of strings in jobs.args");
+    J.ModuleID = J.Args[Common.size()];
+    // Jobs written by older linkers have no instruction count. They are then
+    // run in the order they are listed, with the same memory estimate.
+    J.InstCount = Obj->getInteger("instructions").value_or(0);
+  }
+  return Jobs;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::HideUnrelatedOptions(DistributorCategory);
+  cl::ParseCommandLineOptions(argc, argv,
+                              "Local distributor for distributed ThinLTO\n");
+  ExitOnError ExitOnErr("llvm-dtlto-local: ");
+
+  std::unique_ptr<MemoryBuffer> Buf = ExitOnErr(
+      errorOrToExpected(MemoryBuffer::getFile(JsonFilename, /*IsText=*/true)));
+  json::Value Root = ExitOnErr(json::parse(Buf->getBuffer()));
+  if (!Root.getAsObject())
+    ExitOnErr(createStringError(inconvertibleErrorCode(),
+                                "malformed distributor JSON: expected an "
+                                "object"));
+  SmallVector<StringRef, 0> Common;
+  std::vector<Job> AllJobs = ExitOnErr(readJobs(*Root.getAsObject(), Common));
+
+  std::string Program = Common[0].str();
+  if (!sys::path::has_parent_path(Program))
+    Program = ExitOnErr(errorOrToExpected(sys::findProgramByName(Program)));
+
+  llvm::stable_sort(AllJobs, [](const Job &A, const Job &B) {
+    return A.InstCount > B.InstCount;
+  });
+
+  Scheduler S(AllJobs, MemoryLimit * 1024);
+  {
+    DefaultThreadPool Pool(hardware_concurrency(Jobs));
+    for (unsigned I = 0, E = std::min<size_t>(Pool.getMaxConcurrency(),
+                                               AllJobs.size());
+         I != E; ++I)
+      Pool.async([&] {
+        while (Job *J = S.acquire())
+          runJob(Program, *J, S);
+      });
+    Pool.wait();
+  }
+
+  if (!ReportFilename.empty())
+    ExitOnErr(writeReport(ReportFilename, AllJobs));
+
+  return all_of(AllJobs, [](const Job &J) { return J.Succeeded; }) ? 0 : 1;
+}
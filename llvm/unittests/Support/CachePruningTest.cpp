@@ -7,7 +7,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -64,6 +68,18 @@ TEST(CachePruningPolicyParser, MaxSizeBytes) {
   EXPECT_EQ(4ull * 1024ull * 1024ull * 1024ull, P->MaxSizeBytes);
 }
 
+TEST(CachePruningPolicyParser, PruneBy) {
+  auto P = parseCachePruningPolicy("");
+  ASSERT_TRUE(bool(P));
+  EXPECT_FALSE(P->PruneByCost);
+  P = parseCachePruningPolicy("prune_by=cost");
+  ASSERT_TRUE(bool(P));
+  EXPECT_TRUE(P->PruneByCost);
+  P = parseCachePruningPolicy("prune_by=cost:prune_by=access_time");
+  ASSERT_TRUE(bool(P));
+  EXPECT_FALSE(P->PruneByCost);
+}
+
 TEST(CachePruningPolicyParser, Multiple) {
   auto P = parseCachePruningPolicy("prune_after=1s:cache_size=50%");
   ASSERT_TRUE(bool(P));
@@ -91,6 +107,129 @@ TEST(CachePruningPolicyParser, Errors) {
   EXPECT_EQ(
       "'foo' not an integer",
       toString(parseCachePruningPolicy("cache_size_bytes=foom").takeError()));
+  EXPECT_EQ("'size' must be one of 'cost' or 'access_time'",
+            toString(parseCachePruningPolicy("prune_by=size").takeError()));
   EXPECT_EQ("Unknown key: 'foo'",
             toString(parseCachePruningPolicy("foo=bar").takeError()));
 }
+
+namespace {
+class CachePruningTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        sys::fs::createUniqueDirectory("llvm_test_cache_pruning", CacheDir));
+  }
+
+  void TearDown() override {
+    ASSERT_FALSE(sys::fs::remove_directories(CacheDir));
+  }
+
+  std::string path(const Twine &Name) {
+    SmallString<128> Path(CacheDir);
+    sys::path::append(Path, Name);
+    return std::string(Path);
+  }
+
+  void writeFile(const Twine &Name, StringRef Contents) {
+    std::error_code EC;
+    raw_fd_ostream OS(path(Name), EC);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+  }
+
+  // Writes an entry of Size bytes. If Time is given, also writes a cost file
+  // in the format of localCache() that records Time and Hits.
+  void writeEntry(StringRef Key, size_t Size,
+                  std::optional<std::chrono::seconds> Time = std::nullopt,
+                  uint64_t Hits = 0) {
+    writeFile("llvmcache-" + Key, std::string(Size, 'x'));
+    if (!Time)
+      return;
+    char Header[8];
+    support::endian::write64le(
+        Header, std::chrono::duration_cast<std::chrono::microseconds>(*Time)
+                    .count());
+    writeFile("llvmcache.cost-" + Key,
+              StringRef(Header, sizeof(Header)).str() + std::string(Hits, 1));
+  }
+
+  bool hasEntry(StringRef Key) {
+    return sys::fs::exists(path("llvmcache-" + Key));
+  }
+
+  bool hasCostFile(StringRef Key) {
+    return sys::fs::exists(path("llvmcache.cost-" + Key));
+  }
+
+  // Prunes the cache down to MaxSizeFiles entries.
+  void prune(uint64_t MaxSizeFiles, bool PruneByCost) {
+    CachePruningPolicy Policy;
+    Policy.Interval = std::chrono::seconds(0);
+    Policy.MaxSizePercentageOfAvailableSpace = 0;
+    Policy.MaxSizeFiles = MaxSizeFiles;
+    Policy.PruneByCost = PruneByCost;
+    EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  }
+
+  SmallString<128> CacheDir;
+};
+} // namespace
+
+TEST_F(CachePruningTest, PruneByCost) {
+  // Seconds saved per byte: cost * (hits + 1) / (size + cost file size).
+  // The entries are created in the reverse order of their scores, so that the
+  // least recently used entry is the most valuable one.
+  writeEntry("e", 10, std::chrono::seconds(1));     // 1 / 18
+  writeEntry("b", 100, std::chrono::seconds(1), 3); // 4 / 111
+  writeEntry("a", 100, std::chrono::seconds(1));    // 1 / 108
+  writeEntry("c", 1000, std::chrono::seconds(2));   // 2 / 1008
+  writeEntry("d", 10);                              // no cost file
+
+  prune(3, /*PruneByCost=*/true);
+  EXPECT_FALSE(hasEntry("d"));
+  EXPECT_FALSE(hasEntry("c"));
+  EXPECT_FALSE(hasCostFile("c"));
+  EXPECT_TRUE(hasEntry("a"));
+  EXPECT_TRUE(hasEntry("b"));
+  EXPECT_TRUE(hasEntry("e"));
+
+  prune(2, /*PruneByCost=*/true);
+  EXPECT_FALSE(hasEntry("a"));
+  EXPECT_FALSE(hasCostFile("a"));
+  EXPECT_TRUE(hasEntry("b"));
+  EXPECT_TRUE(hasEntry("e"));
+
+  prune(1, /*PruneByCost=*/true);
+  EXPECT_FALSE(hasEntry("b"));
+  EXPECT_FALSE(hasCostFile("b"));
+  EXPECT_TRUE(hasEntry("e"));
+  EXPECT_TRUE(hasCostFile("e"));
+}
+
+TEST_F(CachePruningTest, PruneByCostMissingCostFiles) {
+  // Entries without a valid cost file are removed before all others,
+  // regardless of their size.
+  writeEntry("cheap", 1000, std::chrono::seconds(1));
+  writeEntry("missing", 1);
+  writeFile("llvmcache-truncated", "x");
+  writeFile("llvmcache.cost-truncated", "1234");
+  prune(1, /*PruneByCost=*/true);
+  EXPECT_FALSE(hasEntry("missing"));
+  EXPECT_FALSE(hasEntry("truncated"));
+  EXPECT_FALSE(hasCostFile("truncated"));
+  EXPECT_TRUE(hasEntry("cheap"));
+  EXPECT_TRUE(hasCostFile("cheap"));
+}
+
+TEST_F(CachePruningTest, OrphanedCostFiles) {
+  // A cost file whose entry was removed, e.g. by an older pruner, is removed
+  // by the next pruning even if no entry needs to be evicted.
+  writeEntry("kept", 10, std::chrono::seconds(1));
+  writeEntry("orphan", 10, std::chrono::seconds(1));
+  ASSERT_FALSE(sys::fs::remove(path("llvmcache-orphan")));
+  prune(10, /*PruneByCost=*/false);
+  EXPECT_TRUE(hasEntry("kept"));
+  EXPECT_TRUE(hasCostFile("kept"));
+  EXPECT_FALSE(hasCostFile("orphan"));
+}
@@ -75,6 +75,51 @@ TEST(Caching, Normal) {
   ASSERT_NO_ERROR(sys::fs::remove_directories(CacheDir.str()));
 }
 
+TEST(Caching, Cost) {
+  SmallString<256> CacheDir;
+  sys::fs::createUniquePath("llvm_test_cache-%%%%%%", CacheDir, true);
+
+  sys::fs::remove_directories(CacheDir.str());
+
+  auto CacheOrErr = localCache("LLVMTestCache", "LLVMTest", CacheDir);
+  ASSERT_TRUE(bool(CacheOrErr));
+  FileCache &Cache = *CacheOrErr;
+  const FileCacheStats *Stats = Cache.getStats();
+  ASSERT_TRUE(Stats);
+
+  SmallString<256> CostPath(CacheDir);
+  sys::path::append(CostPath, "llvmcache.cost-foo");
+
+  {
+    auto AddStreamOrErr = Cache(1, "foo", "");
+    ASSERT_TRUE(bool(AddStreamOrErr));
+    auto FileOrErr = (*AddStreamOrErr)(1, "");
+    ASSERT_TRUE(bool(FileOrErr));
+    (*(*FileOrErr)->OS).write(data, sizeof(data));
+    ASSERT_THAT_ERROR((*FileOrErr)->commit(), Succeeded());
+  }
+  EXPECT_EQ(0u, Stats->Hits.load());
+  EXPECT_EQ(1u, Stats->Misses.load());
+  std::optional<CacheEntryCost> Cost = readCacheEntryCost(CostPath);
+  ASSERT_TRUE(Cost);
+  EXPECT_EQ(0u, Cost->Hits);
+  EXPECT_EQ(uint64_t(Cost->Time.count()), Stats->MissTimeUs.load());
+
+  for (int I = 0; I != 2; ++I) {
+    auto AddStreamOrErr = Cache(1, "foo", "");
+    ASSERT_TRUE(bool(AddStreamOrErr));
+    ASSERT_FALSE(*AddStreamOrErr);
+  }
+  EXPECT_EQ(2u, Stats->Hits.load());
+  EXPECT_EQ(1u, Stats->Misses.load());
+  EXPECT_EQ(2 * uint64_t(Cost->Time.count()), Stats->SavedTimeUs.load());
+  Cost = readCacheEntryCost(CostPath);
+  ASSERT_TRUE(Cost);
+  EXPECT_EQ(2u, Cost->Hits);
+
+  ASSERT_NO_ERROR(sys::fs::remove_directories(CacheDir.str()));
+}
+
 TEST(Caching, WriteAfterCommit) {
   SmallString<256> CacheDir;
   sys::fs::createUniquePath("llvm_test_cache-%%%%%%", CacheDir, true);
@@ -155,6 +155,45 @@ TEST(FileOutputBuffer, Test) {
   ASSERT_EQ(File6Size, 0ULL);
   ASSERT_NO_ERROR(fs::remove(File6.str()));
 
+  // TEST 7: Verify F_modify updates an existing file in place.
+  SmallString<128> File7(TestDirectory);
+  File7.append("/file7");
+  {
+    Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
+        FileOutputBuffer::create(File7, 8192);
+    ASSERT_NO_ERROR(errorToErrorCode(BufferOrErr.takeError()));
+    std::unique_ptr<FileOutputBuffer> &Buffer = *BufferOrErr;
+    memcpy(Buffer->getBufferStart(), "AABBCCDDEEFFGGHHIIJJ", 20);
+    ASSERT_NO_ERROR(errorToErrorCode(Buffer->commit()));
+  }
+  {
+    Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
+        FileOutputBuffer::create(File7, -1, FileOutputBuffer::F_modify);
+    ASSERT_NO_ERROR(errorToErrorCode(BufferOrErr.takeError()));
+    std::unique_ptr<FileOutputBuffer> &Buffer = *BufferOrErr;
+    ASSERT_EQ(Buffer->getBufferSize(), 8192U);
+    // Only overwrite the second half of the header.
+    memcpy(Buffer->getBufferStart() + 10, "XXYYZZWWVV", 10);
+    ASSERT_NO_ERROR(errorToErrorCode(Buffer->commit()));
+  }
+  {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MB = MemoryBuffer::getFile(File7);
+    ASSERT_NO_ERROR(MB.getError());
+    ASSERT_EQ((*MB)->getBufferSize(), 8192U);
+    EXPECT_EQ((*MB)->getBuffer().take_front(20), "AABBCCDDEEXXYYZZWWVV");
+  }
+
+  // F_modify requires the file to exist.
+  SmallString<128> File8(TestDirectory);
+  File8.append("/file8");
+  {
+    Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
+        FileOutputBuffer::create(File8, 8192, FileOutputBuffer::F_modify);
+    ASSERT_EQ(errorToErrorCode(BufferOrErr.takeError()),
+              errc::no_such_file_or_directory);
+  }
+  ASSERT_NO_ERROR(fs::remove(File7.str()));
+
   // Clean up.
   ASSERT_NO_ERROR(fs::remove(TestDirectory.str()));
 }
@@ -37,9 +37,9 @@ TEST(Parallel, sort) {
 }
 
 TEST(Parallel, parallel_for) {
-  // We need to test the case with a TaskSize > 1. We are white-box testing
-  // here. The TaskSize is calculated as (End - Begin) / 1024 at the time of
-  // writing.
+  // We need to test the case with chunks of more than one item. We are
+  // white-box testing here. The chunk size is calculated from the number of
+  // remaining items and threads at the time of writing.
   uint32_t range[2050];
   std::fill(range, range + 2050, 1);
   parallelFor(0, 2049, [&range](size_t I) { ++range[I]; });
@@ -51,6 +51,20 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, parallel_for_each_index_once) {
+  // Items of very different cost make threads claim chunks at different
+  // times. Every index must still be visited exactly once.
+  std::vector<std::atomic<uint32_t>> Visits(100000);
+  parallelFor(0, Visits.size(), [&](size_t I) {
+    volatile size_t Work = 0;
+    for (size_t J = 0, E = I % 97 == 0 ? 10000 : 0; J != E; ++J)
+      Work = Work + J;
+    ++Visits[I];
+  });
+  for (const std::atomic<uint32_t> &V : Visits)
+    ASSERT_EQ(V, 1u);
+}
+
 TEST(Parallel, TransformReduce) {
   // Sum an empty list, check that it works.
   auto identity = [](uint32_t v) { return v; };